@@ -0,0 +1,122 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-26
+ * @copyleft Apache 2.0
+ */
+#include "blockpool.h"
+
+using namespace std;
+
+atomic<size_t> BlockPool::slabBytes_(0);
+atomic<size_t> BlockPool::usedBytes_(0);
+
+// 线程缓存析构后(线程退出、静态对象析构期间)直接和全局仓库打交道
+static thread_local bool localDead = false;
+
+BlockPool::LocalCache::~LocalCache() {
+    for (int cls = 0; cls < CLASS_NUM; cls++) {
+        Flush_(cls, free[cls], 0);
+    }
+    localDead = true;
+}
+
+BlockPool::LocalCache *BlockPool::Local_() {
+    if (localDead) { return nullptr; }
+    static thread_local LocalCache cache;
+    return &cache;
+}
+
+// 仓库永不析构，进程退出时仍可能有缓冲区归还内存块
+BlockPool::Depot *BlockPool::Depot_() {
+    static Depot *depot = new Depot;
+    return depot;
+}
+
+int BlockPool::ClassOf_(size_t size) {
+    int cls = 0;
+    while (SizeOf_(cls) < size) {
+        cls++;
+    }
+    return cls;
+}
+
+char *BlockPool::Acquire(size_t &size) {
+    if (size > MAX_BLOCK) {
+        char *block = static_cast<char *>(malloc(size));
+        if (!block) { throw bad_alloc(); }
+        return block;
+    }
+    int cls = ClassOf_(size);
+    size = SizeOf_(cls);
+    usedBytes_ += size;
+
+    LocalCache *local = Local_();
+    if (!local) {
+        vector<char *> list;
+        Refill_(cls, list);
+        char *block = list.back();
+        list.pop_back();
+        Flush_(cls, list, 0);
+        return block;
+    }
+    vector<char *> &list = local->free[cls];
+    if (list.empty()) {
+        Refill_(cls, list);
+    }
+    char *block = list.back();
+    list.pop_back();
+    return block;
+}
+
+void BlockPool::Release(char *block, size_t size) {
+    if (!block) { return; }
+    if (size > MAX_BLOCK) {
+        free(block);
+        return;
+    }
+    int cls = ClassOf_(size);
+    usedBytes_ -= SizeOf_(cls);
+
+    LocalCache *local = Local_();
+    if (!local) {
+        lock_guard<mutex> locker(Depot_()->mtx);
+        Depot_()->free[cls].push_back(block);
+        return;
+    }
+    vector<char *> &list = local->free[cls];
+    list.push_back(block);
+    if (list.size() * SizeOf_(cls) > LOCAL_CACHE) {
+        /* 留一半，其余交给仓库，避免某个线程囤积另一个线程申请的内存 */
+        Flush_(cls, list, LOCAL_CACHE / 2 / SizeOf_(cls));
+    }
+}
+
+// 先从仓库成批取，仓库也空了就切一块新slab
+void BlockPool::Refill_(int cls, vector<char *> &list) {
+    size_t batch = max<size_t>(1, LOCAL_CACHE / 2 / SizeOf_(cls));
+    {
+        Depot *depot = Depot_();
+        lock_guard<mutex> locker(depot->mtx);
+        vector<char *> &shared = depot->free[cls];
+        size_t n = min(batch, shared.size());
+        list.insert(list.end(), shared.end() - n, shared.end());
+        shared.resize(shared.size() - n);
+    }
+    if (!list.empty()) { return; }
+
+    char *slab = static_cast<char *>(malloc(SLAB_SIZE));
+    if (!slab) { throw bad_alloc(); }
+    slabBytes_ += SLAB_SIZE;
+    for (size_t off = 0; off + SizeOf_(cls) <= SLAB_SIZE; off += SizeOf_(cls)) {
+        list.push_back(slab + off);
+    }
+}
+
+// 把超出keep个的空闲块移交仓库
+void BlockPool::Flush_(int cls, vector<char *> &list, size_t keep) {
+    if (list.size() <= keep) { return; }
+    Depot *depot = Depot_();
+    lock_guard<mutex> locker(depot->mtx);
+    depot->free[cls].insert(depot->free[cls].end(), list.begin() + keep, list.end());
+    list.resize(keep);
+}
@@ -0,0 +1,70 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-26
+ * @copyleft Apache 2.0
+ */
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <stdlib.h>      // malloc, free
+#include <stddef.h>
+#include <new>         // bad_alloc
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+/* 缓冲区内存块池
+ * 块大小按2的幂分级(1KB~64KB)，从256KB的slab中切分，用完归还到当前线程的空闲链表，
+ * 申请和归还都不加锁；线程缓存超过上限时成批移交全局仓库，线程缓存空了再成批取回。
+ * 更大的块直接malloc/free，不做缓存 */
+class BlockPool {
+public:
+    static const size_t MIN_BLOCK = 1024;
+    static const size_t MAX_BLOCK = 64 * 1024;   // 超过此大小不走池
+    static const size_t SLAB_SIZE = 256 * 1024;
+
+    // 申请不小于size字节的块，size改为块的实际大小
+    static char *Acquire(size_t &size);
+
+    // 归还Acquire得到的块，size为Acquire返回的实际大小
+    static void Release(char *block, size_t size);
+
+    // 已向系统申请的slab总字节数
+    static size_t SlabBytes() { return slabBytes_; }
+
+    // 被缓冲区占用(未归还)的池内块总字节数
+    static size_t UsedBytes() { return usedBytes_; }
+
+private:
+    static const int CLASS_NUM = 7;                    // 1K,2K,...,64K
+    static const size_t LOCAL_CACHE = 512 * 1024;      // 每级线程缓存的字节上限
+
+    struct LocalCache {
+        std::vector<char *> free[CLASS_NUM];
+
+        ~LocalCache();
+    };
+
+    struct Depot {
+        std::mutex mtx;
+        std::vector<char *> free[CLASS_NUM];
+    };
+
+    static int ClassOf_(size_t size);
+
+    static size_t SizeOf_(int cls) { return MIN_BLOCK << cls; }
+
+    static LocalCache *Local_();
+
+    static Depot *Depot_();
+
+    static void Refill_(int cls, std::vector<char *> &list);
+
+    static void Flush_(int cls, std::vector<char *> &list, size_t keep);
+
+    static std::atomic<size_t> slabBytes_;
+    static std::atomic<size_t> usedBytes_;
+};
+
+#endif //BLOCK_POOL_H
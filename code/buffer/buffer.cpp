@@ -5,14 +5,21 @@
  */
 #include "buffer.h"
 
-Buffer::Buffer(int initBuffSize) : buffer_(initBuffSize), readPos_(0), writePos_(0) {}
+Buffer::Buffer(int initBuffSize) : initSize_(initBuffSize), buffer_(nullptr), capacity_(initBuffSize),
+                                   readHint_(MIN_READ), readPos_(0), writePos_(0) {
+    buffer_ = BlockPool::Acquire(capacity_);
+}
+
+Buffer::~Buffer() {
+    BlockPool::Release(buffer_, capacity_);
+}
 
 size_t Buffer::ReadableBytes() const {
     return writePos_ - readPos_;
 }
 
 size_t Buffer::WritableBytes() const {
-    return buffer_.size() - writePos_;
+    return capacity_ - writePos_;
 }
 
 // TODO:什么意思
@@ -34,9 +41,8 @@ void Buffer::RetrieveUntil(const char *end) {
     Retrieve(end - Peek());
 }
 
-// 清空
+// 清空，只需复位读写位置
 void Buffer::RetrieveAll() {
-    bzero(&buffer_[0], buffer_.size());
     readPos_ = 0;
     writePos_ = 0;
 }
@@ -94,31 +100,81 @@ void Buffer::EnsureWriteable(size_t len) {
     assert(WritableBytes() >= len);
 }
 
+/* 每个线程一块复用的溢出区，读取量超出缓冲区剩余空间时接住多出的数据
+ * 前HEADROOM字节不参与读取，留给接管溢出区时放入缓冲区中原有的数据 */
+namespace {
+struct Overflow {
+    char *block;
+    size_t size;
+
+    Overflow() : size(BlockPool::MAX_BLOCK) {
+        block = BlockPool::Acquire(size);
+    }
+
+    ~Overflow() {
+        BlockPool::Release(block, size);
+    }
+};
+
+thread_local Overflow overflow;
+}
+
 // 分散读
 ssize_t Buffer::ReadFd(int fd, int *saveErrno) {
-    char buff[65535];
+    /* 按最近的读取量预留空间，大多数读取直接落在缓冲区内，用不到溢出区 */
+    if (WritableBytes() < readHint_) {
+        EnsureWriteable(readHint_);
+    }
     struct iovec iov[2];
     const size_t writable = WritableBytes();
-    /* 分散读， 保证数据全部读完 */
-    iov[0].iov_base = BeginPtr_() + writePos_;
+    iov[0].iov_base = BeginWrite();
     iov[0].iov_len = writable;
-    iov[1].iov_base = buff;
-    iov[1].iov_len = sizeof(buff);
+    iov[1].iov_base = overflow.block + HEADROOM;
+    iov[1].iov_len = overflow.size - HEADROOM;
 
     const ssize_t len = readv(fd, iov, 2);
     if (len < 0) {
         *saveErrno = errno;
-    } else if (static_cast<size_t>(len) <= writable) {
+        return len;
+    }
+    if (static_cast<size_t>(len) <= writable) {
         // 如果读取的数据小于buffer中剩下的空间，那么直接写到buff中
         writePos_ += len;
     } else {
-        // 不然，将buff中数据写入到buffer中
-        writePos_ = buffer_.size();
-        Append(buff, len - writable);
+        writePos_ = capacity_;
+        AdoptOverflow_(len - writable);
     }
+    UpdateReadHint_(len, writable + iov[1].iov_len);
     return len;
 }
 
+/* 溢出区收到了len字节
+ * 溢出量达到溢出区一半、且缓冲区中已有的数据不多时，把它们拷到溢出数据前面，
+ * 整块溢出区直接成为新的存储，溢出的大块数据不再拷贝，线程另取一块溢出区；
+ * 否则把溢出数据追加进来，缓冲区换成刚好够用的块，避免中等大小的请求让连接一直占着64KB */
+void Buffer::AdoptOverflow_(size_t len) {
+    const char *data = overflow.block + HEADROOM;
+    size_t readable = ReadableBytes();
+    if (readable > HEADROOM || len <= readable || len < overflow.size / 2) {
+        Append(data, len);
+        return;
+    }
+    memcpy(overflow.block + HEADROOM - readable, Peek(), readable);
+    BlockPool::Release(buffer_, capacity_);
+    buffer_ = overflow.block;
+    capacity_ = overflow.size;
+    readPos_ = HEADROOM - readable;
+    writePos_ = HEADROOM + len;
+    overflow.size = BlockPool::MAX_BLOCK;
+    overflow.block = BlockPool::Acquire(overflow.size);
+}
+
+// 读取量的滑动平均，读满了所有空间说明还有更多数据，估计值翻倍
+void Buffer::UpdateReadHint_(size_t len, size_t space) {
+    size_t want = len >= space ? readHint_ * 2 : len;
+    readHint_ = std::min(std::max((readHint_ * 3 + want) / 4, MIN_READ), MAX_READ);
+}
+
 // 写
 ssize_t Buffer::WriteFd(int fd, int *saveErrno) {
     size_t readSize = ReadableBytes();
@@ -131,22 +187,45 @@ ssize_t Buffer::WriteFd(int fd, int *saveErrno) {
     return len;
 }
 
+void Buffer::Release() {
+    if (!buffer_ || ReadableBytes() > 0) { return; }
+    BlockPool::Release(buffer_, capacity_);
+    buffer_ = nullptr;
+    capacity_ = 0;
+    readPos_ = 0;
+    writePos_ = 0;
+}
+
 char *Buffer::BeginPtr_() {
-    return &*buffer_.begin();
+    return buffer_;
 }
 
 const char *Buffer::BeginPtr_() const {
-    return &*buffer_.begin();
+    return buffer_;
 }
 
 void Buffer::MakeSpace_(size_t len) {
-    if (WritableBytes() + PrependableBytes() < len) {
-        // 如果剩下的空间不足，就扩容
-        buffer_.resize(writePos_ + len + 1);
+    if (!buffer_) {
+        // 已经还给池子，重新取一块
+        capacity_ = std::max(initSize_, len);
+        buffer_ = BlockPool::Acquire(capacity_);
+        readPos_ = 0;
+        writePos_ = 0;
+    } else if (WritableBytes() + PrependableBytes() < len) {
+        // 如果剩下的空间不足，就换一块至少大一倍的，只拷贝未读的数据
+        size_t readable = ReadableBytes();
+        size_t size = std::max(capacity_ * 2, readable + len);
+        char *block = BlockPool::Acquire(size);
+        memcpy(block, Peek(), readable);
+        BlockPool::Release(buffer_, capacity_);
+        buffer_ = block;
+        capacity_ = size;
+        readPos_ = 0;
+        writePos_ = readable;
     } else {
         // 如果剩下的空间足够存放，那么就移动readPos-writePos到开头
         size_t readable = ReadableBytes();
-        std::copy(BeginPtr_() + readPos_, BeginPtr_() + writePos_, BeginPtr_());
+        memmove(BeginPtr_(), BeginPtr_() + readPos_, readable);
         readPos_ = 0;
         writePos_ = readPos_ + readable;
         assert(readable == ReadableBytes());
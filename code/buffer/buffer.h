@@ -11,17 +11,23 @@
 #include <iostream>
 #include <unistd.h>  // write
 #include <sys/uio.h> //readv
-#include <vector> //readv
+#include <algorithm> // max
 #include <atomic>
 #include <assert.h>
+#include "blockpool.h"
 
-// 缓冲区类 使用vector实现
-// 参考的moduo的设计
+// 缓冲区类 参考的moduo的设计
+// 存储是一块连续内存，取自BlockPool：扩容时换一个更大的块，清空时不再逐字节置零，
+// 连接空闲时可以把块还给池子，下次写入时再取
 class Buffer {
 public:
     Buffer(int initBuffSize = 1024);
 
-    ~Buffer() = default;
+    ~Buffer();
+
+    Buffer(const Buffer &) = delete;
+
+    Buffer &operator=(const Buffer &) = delete;
 
     size_t WritableBytes() const;
 
@@ -62,6 +68,12 @@ public:
 
     ssize_t WriteFd(int fd, int *Errno);
 
+    // 没有未读数据时把内存块还给池子
+    void Release();
+
+    // 当前持有的内存字节数
+    size_t Capacity() const { return capacity_; }
+
 private:
     char *BeginPtr_();
 
@@ -69,7 +81,18 @@ private:
 
     void MakeSpace_(size_t len);
 
-    std::vector<char> buffer_;
+    void AdoptOverflow_(size_t len);
+
+    void UpdateReadHint_(size_t len, size_t space);
+
+    static const size_t HEADROOM = 4096;        // 溢出区前部留给缓冲区已有数据的空间
+    static const size_t MIN_READ = 1024;
+    static const size_t MAX_READ = BlockPool::MAX_BLOCK;
+
+    size_t initSize_;  // 第一次(或Release后)取块的大小
+    char *buffer_;
+    size_t capacity_;
+    size_t readHint_;  // 根据最近的读取量估计的下一次读取量
     std::atomic <std::size_t> readPos_;  // 已读的位置
     std::atomic <std::size_t> writePos_; // 已写的位置
 };
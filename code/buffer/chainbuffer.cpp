@@ -0,0 +1,216 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-26
+ * @copyleft Apache 2.0
+ */
+#include "chainbuffer.h"
+
+ChainBuffer::ChainBuffer(size_t chunkSize) : chunkSize_(chunkSize), readable_(0), capacity_(0) {}
+
+ChainBuffer::~ChainBuffer() {
+    while (!chunks_.empty()) {
+        PopFront_();
+    }
+}
+
+void ChainBuffer::EnsureWriteable(size_t len) {
+    if (!chunks_.empty()) {
+        Chunk &tail = chunks_.back();
+        if (tail.readPos == tail.writePos) {
+            // 最后一块是空的，从头开始写
+            tail.readPos = tail.writePos = 0;
+        }
+        if (tail.size - tail.writePos >= len) { return; }
+        if (tail.writePos == 0) {
+            // 空块不够大，换一块
+            capacity_ -= tail.size;
+            BlockPool::Release(tail.data, tail.size);
+            chunks_.pop_back();
+        }
+    }
+    AddChunk_(len);
+}
+
+char *ChainBuffer::BeginWrite() {
+    assert(!chunks_.empty());
+    return chunks_.back().data + chunks_.back().writePos;
+}
+
+void ChainBuffer::HasWritten(size_t len) {
+    assert(!chunks_.empty() && chunks_.back().writePos + len <= chunks_.back().size);
+    chunks_.back().writePos += len;
+    readable_ += len;
+}
+
+void ChainBuffer::Append(const std::string &str) {
+    Append(str.data(), str.size());
+}
+
+// 先填满最后一块的剩余空间，剩下的放进新的定长块
+void ChainBuffer::Append(const char *str, size_t len) {
+    assert(str || len == 0);
+    while (len > 0) {
+        if (chunks_.empty() || chunks_.back().writePos == chunks_.back().size) {
+            AddChunk_(chunkSize_);
+        }
+        Chunk &tail = chunks_.back();
+        size_t n = std::min(len, tail.size - tail.writePos);
+        memcpy(tail.data + tail.writePos, str, n);
+        tail.writePos += n;
+        readable_ += n;
+        str += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::Append(ChainBuffer &&other) {
+    if (other.readable_ == 0) { return; }
+    if (!chunks_.empty() && chunks_.back().readPos == chunks_.back().writePos) {
+        // 最后一块是空的，用不上了
+        capacity_ -= chunks_.back().size;
+        BlockPool::Release(chunks_.back().data, chunks_.back().size);
+        chunks_.pop_back();
+    }
+    for (const Chunk &chunk: other.chunks_) {
+        chunks_.push_back(chunk);
+    }
+    readable_ += other.readable_;
+    capacity_ += other.capacity_;
+    other.chunks_.clear();
+    other.readable_ = other.capacity_ = 0;
+}
+
+// 读完的块还给池子，最后一块留着继续写
+void ChainBuffer::Retrieve(size_t len) {
+    assert(len <= readable_);
+    readable_ -= len;
+    while (len > 0) {
+        Chunk &head = chunks_.front();
+        size_t n = std::min(len, head.writePos - head.readPos);
+        head.readPos += n;
+        len -= n;
+        if (head.readPos == head.writePos) {
+            if (chunks_.size() > 1) {
+                PopFront_();
+            } else {
+                head.readPos = head.writePos = 0;
+            }
+        }
+    }
+}
+
+void ChainBuffer::RetrieveAll() {
+    while (chunks_.size() > 1) {
+        PopFront_();
+    }
+    if (!chunks_.empty()) {
+        chunks_.front().readPos = chunks_.front().writePos = 0;
+    }
+    readable_ = 0;
+}
+
+std::string ChainBuffer::RetrieveAllToStr() {
+    std::string str;
+    str.reserve(readable_);
+    for (const Chunk &chunk: chunks_) {
+        str.append(chunk.data + chunk.readPos, chunk.writePos - chunk.readPos);
+    }
+    RetrieveAll();
+    return str;
+}
+
+size_t ChainBuffer::Peek(size_t offset, size_t len, std::vector<struct iovec> &iov) const {
+    assert(offset + len <= readable_);
+    size_t total = len;
+    for (auto it = chunks_.begin(); it != chunks_.end() && len > 0; ++it) {
+        size_t readable = it->writePos - it->readPos;
+        if (offset >= readable) {
+            offset -= readable;
+            continue;
+        }
+        char *base = it->data + it->readPos + offset;
+        size_t n = std::min(len, readable - offset);
+        offset = 0;
+        len -= n;
+        const struct iovec *last = iov.empty() ? nullptr : &iov.back();
+        if (last && last->iov_base && static_cast<char *>(last->iov_base) + last->iov_len == base) {
+            iov.back().iov_len += n;
+        } else {
+            iov.push_back({base, n});
+        }
+    }
+    return total;
+}
+
+ssize_t ChainBuffer::ReadFd(int fd, int *saveErrno) {
+    if (chunks_.empty()) {
+        AddChunk_(chunkSize_);
+    }
+    /* 预先取一块接住超出最后一块剩余空间的数据，没用上就还回去 */
+    size_t spareSize = chunkSize_;
+    char *spare = BlockPool::Acquire(spareSize);
+    Chunk &tail = chunks_.back();
+    struct iovec iov[2];
+    const size_t writable = tail.size - tail.writePos;
+    iov[0].iov_base = tail.data + tail.writePos;
+    iov[0].iov_len = writable;
+    iov[1].iov_base = spare;
+    iov[1].iov_len = spareSize;
+    const ssize_t len = readv(fd, iov, 2);
+    if (len < 0) {
+        *saveErrno = errno;
+        BlockPool::Release(spare, spareSize);
+        return len;
+    }
+    if (static_cast<size_t>(len) <= writable) {
+        tail.writePos += len;
+        BlockPool::Release(spare, spareSize);
+    } else {
+        tail.writePos = tail.size;
+        chunks_.push_back({spare, spareSize, 0, len - writable});
+        capacity_ += spareSize;
+    }
+    readable_ += len;
+    return len;
+}
+
+ssize_t ChainBuffer::WriteFd(int fd, int *saveErrno) {
+    struct iovec iov[MAX_IOV];
+    int cnt = 0;
+    for (auto it = chunks_.begin(); it != chunks_.end() && cnt < MAX_IOV; ++it) {
+        if (it->writePos == it->readPos) { continue; }
+        iov[cnt].iov_base = it->data + it->readPos;
+        iov[cnt].iov_len = it->writePos - it->readPos;
+        cnt++;
+    }
+    if (cnt == 0) { return 0; }
+    const ssize_t len = writev(fd, iov, cnt);
+    if (len < 0) {
+        *saveErrno = errno;
+        return len;
+    }
+    Retrieve(len);
+    return len;
+}
+
+void ChainBuffer::Release() {
+    if (readable_ > 0) { return; }
+    while (!chunks_.empty()) {
+        PopFront_();
+    }
+}
+
+// 挂一块至少len字节的新块，不小于chunkSize_
+void ChainBuffer::AddChunk_(size_t len) {
+    size_t size = std::max(chunkSize_, len);
+    char *data = BlockPool::Acquire(size);
+    chunks_.push_back({data, size, 0, 0});
+    capacity_ += size;
+}
+
+void ChainBuffer::PopFront_() {
+    Chunk &head = chunks_.front();
+    capacity_ -= head.size;
+    BlockPool::Release(head.data, head.size);
+    chunks_.pop_front();
+}
@@ -0,0 +1,93 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef CHAIN_BUFFER_H
+#define CHAIN_BUFFER_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <string.h>  // memcpy
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h> // readv, writev
+#include <assert.h>
+#include "blockpool.h"
+
+/* 块链缓冲区：存储是一串取自BlockPool的内存块，写满了就再挂一块，已写入的数据从不搬移
+ * 追加另一个ChainBuffer时直接接过它的块，不拷贝数据；读完的块立即还给池子；
+ * 任意一段数据都可以导出为iovec，交给readv/writev/sendmsg。
+ * 数据不保证连续，需要连续解析的读缓冲区仍用Buffer */
+class ChainBuffer {
+public:
+    explicit ChainBuffer(size_t chunkSize = 4096);
+
+    ~ChainBuffer();
+
+    ChainBuffer(const ChainBuffer &) = delete;
+
+    ChainBuffer &operator=(const ChainBuffer &) = delete;
+
+    size_t ReadableBytes() const { return readable_; }
+
+    // 当前持有的内存字节数
+    size_t Capacity() const { return capacity_; }
+
+    // 保证最后一块至少有len字节连续的可写空间，不够时挂一块新的
+    void EnsureWriteable(size_t len);
+
+    char *BeginWrite();
+
+    void HasWritten(size_t len);
+
+    // 追加数据，可以跨块
+    void Append(const std::string &str);
+
+    void Append(const char *str, size_t len);
+
+    // 接过other的所有块，数据不拷贝，other变为空
+    void Append(ChainBuffer &&other);
+
+    void Retrieve(size_t len);
+
+    // 清空，只保留第一块
+    void RetrieveAll();
+
+    std::string RetrieveAllToStr();
+
+    // 把可读数据中[offset, offset+len)这一段追加到iov，与iov最后一项首尾相接时合并；返回追加的字节数
+    size_t Peek(size_t offset, size_t len, std::vector<struct iovec> &iov) const;
+
+    // 分散读：先填满最后一块，多出的读进新块
+    ssize_t ReadFd(int fd, int *saveErrno);
+
+    // 集中写：所有块一次writev
+    ssize_t WriteFd(int fd, int *saveErrno);
+
+    // 没有未读数据时把所有块还给池子
+    void Release();
+
+private:
+    struct Chunk {
+        char *data;
+        size_t size;
+        size_t readPos;
+        size_t writePos;
+    };
+
+    void AddChunk_(size_t len);
+
+    void PopFront_();
+
+    static const int MAX_IOV = 64;
+
+    size_t chunkSize_;
+    std::deque<Chunk> chunks_;
+    size_t readable_;
+    size_t capacity_;
+};
+
+#endif //CHAIN_BUFFER_H
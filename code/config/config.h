@@ -2,4 +2,75 @@
  * @Author       : mark
  * @Date         : 2020-06-28
  * @copyleft Apache 2.0
- */ 
+ */
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stddef.h>
+
+// 服务器的扩展配置，基础配置仍然通过WebServer的构造函数传入
+struct Config {
+    /* one loop per thread模式下的Reactor数量
+     * 0表示原有模式：主线程一个epoll循环，读写交给线程池
+     * >0表示每个线程独占一个epoll循环、定时器和连接，各自使用SO_REUSEPORT监听 */
+    int reactorNum = 0;
+
+    /* 线程池使用工作窃取：每个线程一个无锁双端队列，事件循环提交的任务进入无锁注入队列 */
+    bool workStealing = false;
+
+    /* 线程池任务队列的容量，队列满时说明已经过载：
+     * rejectOverload为false时不再为该连接注册EPOLLIN，等队列有空位再处理它，
+     * 为true时直接回复503并关闭连接 */
+    size_t taskQueueSize = 4096;
+    bool rejectOverload = false;
+
+    /* 线程池慢速通道的线程数：读到请求行后，登录/注册这类要查询数据库的请求交给慢速通道处理，
+     * 不占用处理静态文件的线程；0表示不区分通道。工作窃取线程池不分通道 */
+    int dbThreadNum = 0;
+
+    /* 线程池弹性伸缩：任务排队超过threadGrowWaitUS微秒时增加线程，最多threadMaxNum个(慢速通道按比例)，
+     * 多出的线程空闲threadIdleMS毫秒后退出；threadMaxNum不大于初始线程数时线程数固定 */
+    int threadMaxNum = 0;
+    int threadGrowWaitUS = 2000;
+    int threadIdleMS = 30000;
+
+    /* 每隔metricsIntervalMS毫秒在日志中输出线程池(线程数、队列深度、排队时间分布、各线程忙碌比例)
+     * 和缓冲区内存的统计，0表示不输出 */
+    int metricsIntervalMS = 0;
+
+    /* 使用io_uring代替epoll作为事件后端，内核不支持时自动回退到epoll */
+    bool ioUring = false;
+
+    /* 使用分层时间轮代替小根堆管理连接超时，刷新超时为O(1) */
+    bool timeWheel = false;
+
+    /* 文件大小达到该值时不再mmap，响应头用writev发送、文件用sendfile发送，0表示总是mmap */
+    size_t sendfileThreshold = 64 * 1024;
+
+    /* 长连接发完响应、等待下一个请求时释放读写缓冲区的内存，收到数据时再从池中取 */
+    bool releaseIdleBuffer = false;
+
+    /* 静态文件缓存的总字节数，0表示不缓存 */
+    size_t fileCacheSize = 64 * 1024 * 1024;
+
+    /* 静态文件缓存中最多保持打开的描述符数(用sendfile发送的大文件)，按分片均分，
+     * 超过时淘汰最久未使用的大文件；小于分片数时大文件不缓存，每次请求打开、发完关闭 */
+    size_t fileCacheFds = 256;
+
+    /* 启动时把整个资源目录预加载到内存，之后不再访问文件系统，收到SIGHUP时重新加载 */
+    bool preload = false;
+
+    /* 启动时为资源目录中不小于precompressMinSize字节的文本文件生成.gz/.br变体，
+     * 按请求的Accept-Encoding发送压缩后的版本 */
+    bool precompress = false;
+    size_t precompressMinSize = 1024;
+
+    /* 没有预压缩变体的文本文件和动态生成的内容即时gzip压缩，
+     * 文件的压缩结果放进静态文件缓存，动态内容用chunked编码边压缩边发送 */
+    bool gzip = false;
+    int gzipLevel = 6;                      /* 压缩级别1~9 */
+    size_t gzipMinSize = 1024;              /* 小于该字节数不压缩 */
+    size_t gzipMaxSize = 4 * 1024 * 1024;   /* 大于该字节数不做即时压缩 */
+};
+
+#endif //CONFIG_H
@@ -0,0 +1,74 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-28
+ * @copyleft Apache 2.0
+ */
+#include "deflater.h"
+
+using namespace std;
+
+int Deflater::level = 0;
+size_t Deflater::minSize = 1024;
+size_t Deflater::maxSize = 4 * 1024 * 1024;
+
+Deflater::Deflater() {
+    memset(&zs_, 0, sizeof(zs_));
+    curLevel_ = level > 0 ? level : Z_DEFAULT_COMPRESSION;
+    // windowBits加16输出gzip格式
+    valid_ = deflateInit2(&zs_, curLevel_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+Deflater::~Deflater() {
+    if (valid_) {
+        deflateEnd(&zs_);
+    }
+}
+
+Deflater *Deflater::Local() {
+    static thread_local Deflater deflater;
+    return &deflater;
+}
+
+bool Deflater::Gzip(const char *data, size_t len, string &out) {
+    if (!valid_ || deflateReset(&zs_) != Z_OK) {
+        return false;
+    }
+    size_t start = out.size();
+    out.resize(start + deflateBound(&zs_, len));
+    zs_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    zs_.avail_in = len;
+    zs_.next_out = reinterpret_cast<Bytef *>(&out[start]);
+    zs_.avail_out = out.size() - start;
+    int ret = deflate(&zs_, Z_FINISH);
+    out.resize(start + zs_.total_out);
+    return ret == Z_STREAM_END;
+}
+
+bool Deflater::GzipChunked(const char *data, size_t len, ChainBuffer &buff) {
+    if (!valid_ || deflateReset(&zs_) != Z_OK) {
+        return false;
+    }
+    zs_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    zs_.avail_in = len;
+    int ret;
+    do {
+        /* 预留定宽的块头，压缩输出直接写进缓冲区，写完再回填长度 */
+        buff.EnsureWriteable(CHUNK_HEAD + CHUNK_SIZE + 2);
+        char *head = buff.BeginWrite();
+        zs_.next_out = reinterpret_cast<Bytef *>(head + CHUNK_HEAD);
+        zs_.avail_out = CHUNK_SIZE;
+        ret = deflate(&zs_, Z_FINISH);
+        if (ret == Z_STREAM_ERROR) {
+            return false;
+        }
+        size_t have = CHUNK_SIZE - zs_.avail_out;
+        if (have == 0) { continue; }
+        char size[24];
+        snprintf(size, sizeof(size), "%08zx\r\n", have);
+        memcpy(head, size, CHUNK_HEAD);
+        memcpy(head + CHUNK_HEAD + have, "\r\n", 2);
+        buff.HasWritten(CHUNK_HEAD + have + 2);
+    } while (ret != Z_STREAM_END);
+    buff.Append("0\r\n\r\n", 5);
+    return true;
+}
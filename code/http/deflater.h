@@ -0,0 +1,55 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-28
+ * @copyleft Apache 2.0
+ */
+#ifndef DEFLATER_H
+#define DEFLATER_H
+
+#include <string>
+#include <string.h>      // memset
+#include <stdio.h>       // snprintf
+#include <zlib.h>
+
+#include "../buffer/chainbuffer.h"
+
+/* 即时gzip压缩，每个线程一个压缩器：z_stream只初始化一次，
+ * 每次压缩前deflateReset，复用几百KB的窗口和哈希表而不是每个响应都重新分配 */
+class Deflater {
+public:
+    // 当前线程的压缩器
+    static Deflater *Local();
+
+    bool IsValid() const { return valid_; }
+
+    // 压缩成gzip格式追加到out
+    bool Gzip(const char *data, size_t len, std::string &out);
+
+    // 压缩成gzip并按chunked编码边压缩边写入buff，最后写入结束块；失败时buff中可能留有不完整的块
+    bool GzipChunked(const char *data, size_t len, ChainBuffer &buff);
+
+    // 压缩策略：是否值得即时压缩len字节的内容
+    static bool Worth(size_t len) { return level > 0 && len >= minSize && len <= maxSize; }
+
+    static int level;       // 压缩级别1~9，0表示关闭即时压缩
+    static size_t minSize;  // 小于该字节数时压缩的收益抵不过开销
+    static size_t maxSize;  // 超过该字节数时不做即时压缩，避免占用过多CPU和内存
+
+private:
+    Deflater();
+
+    ~Deflater();
+
+    Deflater(const Deflater &) = delete;
+
+    Deflater &operator=(const Deflater &) = delete;
+
+    static const size_t CHUNK_HEAD = 10;  // 定宽的"xxxxxxxx\r\n"
+    static const size_t CHUNK_SIZE = 16 * 1024 - CHUNK_HEAD - 2;  // 连同块头和结尾的"\r\n"正好一个16KB的池块
+
+    z_stream zs_;
+    bool valid_;
+    int curLevel_;
+};
+
+#endif //DEFLATER_H
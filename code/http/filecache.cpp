@@ -0,0 +1,364 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-27
+ * @copyleft Apache 2.0
+ */
+#include "filecache.h"
+#include "httpresponse.h"
+
+using namespace std;
+
+const char FileCache::GZIP_KEY[] = "\n gzip";
+
+FileCache::FileCache() : shardCapacity_(0), shardFds_(0), inotifyFd_(-1), reloads_(0) {}
+
+FileCache *FileCache::Instance() {
+    static FileCache cache;
+    return &cache;
+}
+
+void FileCache::Init(const string &srcDir, size_t capacity, size_t maxFds) {
+    Clear();
+    atomic_store(&arena_, shared_ptr<const StaticArena>());
+    srcDir_ = srcDir;
+    while (!srcDir_.empty() && srcDir_.back() == '/') {
+        srcDir_.pop_back();
+    }
+    shardCapacity_ = capacity / SHARD_NUM;
+    shardFds_ = maxFds / SHARD_NUM;
+    if (shardCapacity_ == 0 || inotifyFd_ >= 0) { return; }
+
+    inotifyFd_ = inotify_init1(IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        /* 无法感知文件变化时不能缓存 */
+        LOG_ERROR("inotify init error, file cache disabled!");
+        shardCapacity_ = 0;
+        return;
+    }
+    AddWatch_("");
+    // 监听线程与进程同生命周期
+    std::thread(&FileCache::WatchThread_, this).detach();
+}
+
+FileCache::Shard &FileCache::Shard_(const string &path) {
+    return shards_[hash<string>()(path) % SHARD_NUM];
+}
+
+bool FileCache::Preload() {
+    shared_ptr<const StaticArena> arena = StaticArena::Build(srcDir_);
+    if (!arena) {
+        LOG_ERROR("preload %s error!", srcDir_.data());
+        return false;
+    }
+    atomic_store(&arena_, arena);
+    /* 旧文件的压缩结果不再有效 */
+    Clear();
+    LOG_INFO("preload %zu files, %zu bytes, huge page: %s",
+             arena->FileCount(), arena->Bytes(), arena->HugePage() ? "true" : "false");
+    return true;
+}
+
+void FileCache::PreloadAsync(function<void()> done) {
+    if (reloads_.fetch_add(1) > 0) {
+        // 已有线程在加载，它会在结束前再加载一次
+        return;
+    }
+    /* 扫描和读入整个资源目录可能很慢，不能占用事件循环；建好后原子替换，请求始终看到完整的预加载区 */
+    std::thread([this, done] {
+        int handled;
+        do {
+            handled = reloads_.load();
+            Preload();
+            if (done) { done(); }
+        } while (reloads_.fetch_sub(handled) != handled);
+    }).detach();
+}
+
+shared_ptr<const FileEntry> FileCache::Get(const string &path) {
+    shared_ptr<const StaticArena> arena = atomic_load(&arena_);
+    if (arena) {
+        return arena->Find(path);
+    }
+
+    uint64_t epoch;
+    shared_ptr<const FileEntry> entry = Find_(path, &epoch);
+    if (entry) {
+        return entry;
+    }
+    /* 未命中：在锁外加载文件 */
+    entry = Load_(path);
+    if (!entry) {
+        return nullptr;
+    }
+    return Insert_(path, std::move(entry), epoch);
+}
+
+bool FileCache::Stat(const string &path, struct stat &st) {
+    shared_ptr<const StaticArena> arena = atomic_load(&arena_);
+    shared_ptr<const FileEntry> entry = arena ? arena->Find(path) : Find_(path);
+    if (entry) {
+        st = entry->st;
+        return true;
+    }
+    if (arena) {
+        return false;
+    }
+    return stat((srcDir_ + path).data(), &st) == 0 && !S_ISDIR(st.st_mode);
+}
+
+shared_ptr<const FileEntry> FileCache::GetGzip(const string &path, const shared_ptr<const FileEntry> &file) {
+    string key = path + GZIP_KEY;
+    uint64_t epoch;
+    shared_ptr<const FileEntry> entry = Find_(key, &epoch);
+    if (entry) {
+        return entry;
+    }
+    /* file可能是失效前取到的旧项，不是最新的时只压缩本次使用，不放入缓存 */
+    bool current;
+    shared_ptr<const StaticArena> arena = atomic_load(&arena_);
+    if (arena) {
+        /* 预加载区的文件只随整个预加载区替换，file由当前的预加载区持有就是最新的，不用访问文件系统 */
+        current = !file.owner_before(arena) && !arena.owner_before(file);
+    } else {
+        struct stat st;
+        current = stat((srcDir_ + path).data(), &st) == 0 && st.st_ino == file->st.st_ino &&
+                  st.st_size == file->st.st_size && st.st_mtim.tv_sec == file->st.st_mtim.tv_sec &&
+                  st.st_mtim.tv_nsec == file->st.st_mtim.tv_nsec;
+    }
+
+    /* 未命中：在锁外压缩，大文件没有映射时先读出来 */
+    size_t size = file->st.st_size;
+    string content;
+    const char *src = file->data;
+    if (!src && file->fd >= 0) {
+        content.resize(size);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t len = pread(file->fd, &content[done], size - done, done);
+            if (len < 0 && errno == EINTR) { continue; }
+            if (len <= 0) { return nullptr; }
+            done += len;
+        }
+        src = content.data();
+    }
+    if (!src) {
+        return nullptr;
+    }
+    shared_ptr<FileEntry> gzip = make_shared<FileEntry>();
+    if (!Deflater::Local()->Gzip(src, size, gzip->body) || gzip->body.size() >= size) {
+        return nullptr;
+    }
+    gzip->st = file->st;
+    gzip->st.st_size = gzip->body.size();
+    gzip->data = &gzip->body[0];
+    gzip->ownsData = false;
+    HttpResponse::FillEntry(*gzip, path + ".gz");
+    if (!current) {
+        return gzip;
+    }
+    return Insert_(key, std::move(gzip), epoch);
+}
+
+void FileCache::Invalidate(const string &path) {
+    Erase_(path);
+    Erase_(path + GZIP_KEY);
+}
+
+// 未命中时通过epoch返回分片当前的失效计数，之后交给Insert_
+shared_ptr<const FileEntry> FileCache::Find_(const string &key, uint64_t *epoch) {
+    Shard &shard = Shard_(key);
+    lock_guard<mutex> locker(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        if (epoch) { *epoch = shard.epoch; }
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->second;
+}
+
+// 放入缓存并按容量淘汰，返回最终缓存中的那一项
+// epoch为加载前Find_取到的失效计数，加载期间分片有过失效时不缓存，避免旧内容覆盖失效
+shared_ptr<const FileEntry> FileCache::Insert_(const string &key, shared_ptr<const FileEntry> entry,
+                                               uint64_t epoch) {
+    if (Cost_(*entry) > shardCapacity_ || (entry->fd >= 0 && shardFds_ == 0)) {
+        /* 不缓存的项只在本次传输中使用，最后一个响应放下引用时关闭描述符 */
+        return entry;
+    }
+    Shard &shard = Shard_(key);
+    lock_guard<mutex> locker(shard.mtx);
+    if (shard.epoch != epoch) {
+        return entry;
+    }
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // 其他线程已经加载过
+        return it->second->second;
+    }
+    shard.lru.emplace_front(key, entry);
+    shard.index[key] = shard.lru.begin();
+    shard.bytes += Cost_(*entry);
+    if (entry->fd >= 0) { shard.fds++; }
+    /* 淘汰最久未使用的，正在发送中的响应仍持有引用 */
+    while (shard.bytes > shardCapacity_) {
+        Evict_(shard, prev(shard.lru.end()));
+    }
+    if (shard.fds > shardFds_) {
+        /* 描述符超出上限：从表尾找最久未使用的大文件淘汰，小文件不占描述符 */
+        auto pos = shard.lru.end();
+        while (shard.fds > shardFds_) {
+            auto victim = --pos;
+            if (victim->second->fd >= 0) {
+                ++pos;
+                Evict_(shard, victim);
+            }
+        }
+    }
+    return entry;
+}
+
+void FileCache::Evict_(Shard &shard, decltype(Shard::lru)::iterator it) {
+    shard.bytes -= Cost_(*it->second);
+    if (it->second->fd >= 0) { shard.fds--; }
+    shard.index.erase(it->first);
+    shard.lru.erase(it);
+}
+
+void FileCache::Erase_(const string &key) {
+    Shard &shard = Shard_(key);
+    lock_guard<mutex> locker(shard.mtx);
+    shard.epoch++;
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) { return; }
+    LOG_DEBUG("file cache invalidate %s", key.c_str());
+    Evict_(shard, it->second);
+}
+
+void FileCache::Clear() {
+    for (auto &shard: shards_) {
+        lock_guard<mutex> locker(shard.mtx);
+        shard.lru.clear();
+        shard.index.clear();
+        shard.bytes = 0;
+        shard.fds = 0;
+        shard.epoch++;
+    }
+}
+
+// 读取文件的元数据并打开，小文件做mmap映射，大文件保留描述符给sendfile
+shared_ptr<FileEntry> FileCache::Load_(const string &path) const {
+    shared_ptr<FileEntry> entry = make_shared<FileEntry>();
+    string file = srcDir_ + path;
+    if (stat(file.data(), &entry->st) < 0 || S_ISDIR(entry->st.st_mode)) {
+        return nullptr;
+    }
+    HttpResponse::FillEntry(*entry, path);
+    if (HttpResponse::IsCompressible(path) && entry->encoding.empty()) {
+        struct stat zst;
+        if (stat((file + ".gz").data(), &zst) == 0) { entry->variants |= FileEntry::GZIP; }
+        if (stat((file + ".br").data(), &zst) == 0) { entry->variants |= FileEntry::BR; }
+    }
+    if (!entry->Readable()) {
+        // 没有读权限，只保留元数据用于返回403
+        return entry;
+    }
+
+    int srcFd = open(file.data(), O_RDONLY | O_CLOEXEC);
+    if (srcFd < 0) {
+        return nullptr;
+    }
+    size_t size = entry->st.st_size;
+    if (HttpResponse::sendfileThreshold > 0 && size >= HttpResponse::sendfileThreshold) {
+        entry->fd = srcFd;
+    } else {
+        if (size > 0) {
+            void *mmRet = mmap(0, size, PROT_READ, MAP_PRIVATE, srcFd, 0);
+            if (mmRet == MAP_FAILED) {
+                close(srcFd);
+                return nullptr;
+            }
+            entry->data = static_cast<char *>(mmRet);
+        }
+        close(srcFd);
+    }
+    return entry;
+}
+
+// 缓存项占用的字节数：映射的文件内容加上元数据
+size_t FileCache::Cost_(const FileEntry &entry) {
+    size_t cost = sizeof(FileEntry) + entry.headers.size() + entry.mimeType.size();
+    if (entry.data) {
+        cost += entry.st.st_size;
+    }
+    return cost;
+}
+
+// 递归监听目录，dir为相对srcDir的路径
+void FileCache::AddWatch_(const string &dir) {
+    string full = srcDir_ + dir;
+    int wd = inotify_add_watch(inotifyFd_, full.data(),
+                               IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                               IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+    if (wd < 0) {
+        LOG_WARN("inotify watch %s error!", full.data());
+        return;
+    }
+    {
+        lock_guard<mutex> locker(watchMtx_);
+        watchDir_[wd] = dir;
+    }
+    DIR *dp = opendir(full.data());
+    if (!dp) { return; }
+    while (struct dirent *ent = readdir(dp)) {
+        if (ent->d_type == DT_DIR && strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+            AddWatch_(dir + "/" + ent->d_name);
+        }
+    }
+    closedir(dp);
+}
+
+void FileCache::WatchThread_() {
+    alignas(struct inotify_event) char buff[4096];
+    while (true) {
+        ssize_t len = read(inotifyFd_, buff, sizeof(buff));
+        if (len <= 0) {
+            if (errno == EINTR) { continue; }
+            break;
+        }
+        for (char *p = buff; p < buff + len;) {
+            const struct inotify_event *ev = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                /* 事件丢失，无法确定哪些文件变了 */
+                Clear();
+                continue;
+            }
+            string dir;
+            {
+                lock_guard<mutex> locker(watchMtx_);
+                auto it = watchDir_.find(ev->wd);
+                if (it == watchDir_.end()) { continue; }
+                dir = it->second;
+                if (ev->mask & IN_IGNORED) {
+                    watchDir_.erase(it);
+                    continue;
+                }
+            }
+            if (ev->len == 0) { continue; }
+            string path = dir + "/" + ev->name;
+            if (ev->mask & IN_ISDIR) {
+                if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    AddWatch_(path);
+                }
+                /* 目录被移动或删除，其下的缓存项全部失效 */
+                Clear();
+            } else {
+                Invalidate(path);
+                if (HttpResponse::IsEncodedVariant(path)) {
+                    /* 原文件记录了有哪些预压缩变体 */
+                    Invalidate(path.substr(0, path.size() - 3));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-27
+ * @copyleft Apache 2.0
+ */
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <string>
+#include <list>
+#include <stdint.h>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>       // open
+#include <unistd.h>      // close, pread
+#include <errno.h>
+#include <dirent.h>      // opendir
+#include <sys/stat.h>    // stat
+#include <sys/inotify.h>
+
+#include "../log/log.h"
+#include "fileentry.h"
+#include "staticarena.h"
+#include "deflater.h"
+
+/* 进程内共享的静态文件缓存：路径 -> 文件描述符或映射、大小、修改时间、MIME类型、预生成的响应头
+ * 按路径哈希分片，每个分片一把锁和一条LRU链表，按字节数和打开的描述符数淘汰；
+ * 用inotify监听资源目录，文件被修改、删除或移动时让对应的缓存项失效；
+ * 开启预加载后只查预加载区，资源目录的变化要通过重新加载才会生效 */
+class FileCache {
+public:
+    static FileCache *Instance();
+
+    // capacity为缓存的总字节数，0表示不缓存(每次都从磁盘加载)；maxFds为缓存中最多打开的描述符数
+    void Init(const std::string &srcDir, size_t capacity, size_t maxFds = 256);
+
+    // 把整个资源目录读入预加载区，再次调用时重新加载并原子地替换，失败时保留原来的
+    bool Preload();
+
+    // 在后台线程中Preload，完成后调用done；加载期间再次调用时合并，当前这次结束后只再加载一次
+    void PreloadAsync(std::function<void()> done = nullptr);
+
+    // path为相对srcDir的路径，文件不存在或是目录时返回nullptr
+    std::shared_ptr<const FileEntry> Get(const std::string &path);
+
+    // 只取文件的元数据：命中缓存时直接返回，否则只stat而不打开文件；不存在或是目录时返回false
+    bool Stat(const std::string &path, struct stat &st);
+
+    // 文件即时gzip压缩的结果，与文件共用缓存容量，文件变化时一起失效；无法压缩时返回nullptr
+    std::shared_ptr<const FileEntry> GetGzip(const std::string &path, const std::shared_ptr<const FileEntry> &file);
+
+    void Invalidate(const std::string &path);
+
+    void Clear();
+
+private:
+    FileCache();
+
+    ~FileCache() = default;
+
+    struct Shard {
+        std::mutex mtx;
+        std::list<std::pair<std::string, std::shared_ptr<const FileEntry>>> lru;  // 表头为最近使用
+        std::unordered_map<std::string, decltype(lru)::iterator> index;
+        size_t bytes = 0;
+        size_t fds = 0;      // 缓存项持有的描述符数
+        uint64_t epoch = 0;  // 每次失效加一，锁外加载期间变过的结果不放入缓存
+    };
+
+    static const int SHARD_NUM = 16;
+    static const char GZIP_KEY[];  // 加在路径后作为压缩结果的键，请求路径中不会出现
+
+    Shard &Shard_(const std::string &path);
+
+    std::shared_ptr<const FileEntry> Find_(const std::string &key, uint64_t *epoch = nullptr);
+
+    std::shared_ptr<const FileEntry> Insert_(const std::string &key, std::shared_ptr<const FileEntry> entry,
+                                             uint64_t epoch);
+
+    void Erase_(const std::string &key);
+
+    void Evict_(Shard &shard, decltype(Shard::lru)::iterator it);
+
+    std::shared_ptr<FileEntry> Load_(const std::string &path) const;
+
+    static size_t Cost_(const FileEntry &entry);
+
+    void AddWatch_(const std::string &dir);
+
+    void WatchThread_();
+
+    std::string srcDir_;
+    size_t shardCapacity_;
+    size_t shardFds_;
+
+    int inotifyFd_;
+    std::mutex watchMtx_;
+    std::unordered_map<int, std::string> watchDir_;  // inotify watch -> 相对srcDir的目录
+
+    Shard shards_[SHARD_NUM];
+
+    std::shared_ptr<const StaticArena> arena_;  // 用atomic_load/atomic_store访问
+    std::atomic<int> reloads_;  // 还没完成的后台加载请求数
+};
+
+#endif //FILE_CACHE_H
@@ -0,0 +1,42 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-27
+ * @copyleft Apache 2.0
+ */
+#ifndef FILE_ENTRY_H
+#define FILE_ENTRY_H
+
+#include <string>
+#include <unistd.h>      // close
+#include <sys/stat.h>    // stat
+#include <sys/mman.h>    // munmap
+
+// 静态文件缓存项，创建后只读，正在发送的响应通过shared_ptr持有，被淘汰或失效后依然有效
+struct FileEntry {
+    // 预压缩变体，用作位掩码
+    enum Encoding {
+        GZIP = 1,
+        BR = 2,
+    };
+
+    struct stat st;
+    char *data = nullptr;   // 小文件的mmap映射、预加载区中的内容或者body
+    bool ownsData = true;   // data是否为该项单独的映射，预加载区中的由整个区域统一释放
+    int fd = -1;            // 大文件的描述符，用于sendfile
+    std::string mimeType;
+    std::string encoding;   // 预压缩变体(a.css.gz)的Content-Encoding，其他文件为空
+    int variants = 0;       // 原文件存在的预压缩变体，Encoding的组合
+    std::string etag;       // 由inode、大小、修改时间和编码生成的强校验值，带引号
+    std::string lastModified;
+    std::string headers;    // 预先生成的Content-type、Content-Encoding、Vary、ETag、Last-Modified、Content-length头以及空行
+    std::string body;       // 即时压缩的结果，此时data指向这里
+
+    ~FileEntry() {
+        if (data && ownsData) { munmap(data, st.st_size); }
+        if (fd >= 0) { close(fd); }
+    }
+
+    bool Readable() const { return st.st_mode & S_IROTH; }
+};
+
+#endif //FILE_ENTRY_H
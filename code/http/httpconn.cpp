@@ -10,11 +10,16 @@ using namespace std;
 const char *HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+bool HttpConn::releaseIdle;
+std::atomic<size_t> HttpConn::idleBytes;
 
 HttpConn::HttpConn() {
     fd_ = -1;
     addr_ = {0};
     isClose_ = true;
+    isKeepAlive_ = false;
+    iovIdx_ = fileIdx_ = toWrite_ = responseCnt_ = idleHeld_ = 0;
+    pins_ = 0;
 };
 
 HttpConn::~HttpConn() {
@@ -23,26 +28,73 @@ HttpConn::~HttpConn() {
 
 void HttpConn::init(int fd, const sockaddr_in &addr) {
     assert(fd > 0);
+    /* fd被复用时，上一个连接遗留的任务可能还没退出，等它放下连接 */
+    while ((pins_.load() & ~CLOSED) != 0) {
+        std::this_thread::yield();
+    }
+    pins_ = 0;
     userCount++;
     addr_ = addr;
     fd_ = fd;
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll();
+    request_.Init();
+    iov_.clear();
+    files_.clear();
+    iovIdx_ = fileIdx_ = toWrite_ = responseCnt_ = 0;
+    isKeepAlive_ = false;
     isClose_ = false;
-    LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int) userCount);
+    LOG_INFO("Client[%d](%s:%d) in, userCount:%d, idleBytes:%zu", fd_, GetIP(), GetPort(), (int) userCount,
+             (size_t) idleBytes);
 }
 
 // 关闭http
 void HttpConn::Close() {
-    response_.UnmapFile();
     if (isClose_ == false) {
         isClose_ = true;
         userCount--;
         close(fd_);
+        /* 连接槽位会一直保留，文件和缓冲区的内存先释放，下一个连接用到时再取；
+         * 还有任务持有连接时(如超时关闭时工作线程正在读写)，交给最后一个任务释放 */
+        if ((pins_.fetch_or(CLOSED) & ~CLOSED) == 0) {
+            ReleaseResources_();
+        }
         LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, GetIP(), GetPort(), (int) userCount);
     }
 }
 
+bool HttpConn::Pin() {
+    uint32_t pins = pins_.load();
+    do {
+        if (pins & CLOSED) { return false; }
+    } while (!pins_.compare_exchange_weak(pins, pins + 1));
+    return true;
+}
+
+void HttpConn::Unpin() {
+    uint32_t pins = pins_.load();
+    while (true) {
+        if (pins == (CLOSED | 1)) {
+            /* 已关闭且只剩自己：不会再有Pin成功，init也在等计数归零，可以独占地释放 */
+            ReleaseResources_();
+            pins_ = CLOSED;
+            return;
+        }
+        if (pins_.compare_exchange_weak(pins, pins - 1)) { return; }
+    }
+}
+
+void HttpConn::ReleaseResources_() {
+    Wake_();
+    for (auto &response: responses_) {
+        response->UnmapFile();
+    }
+    writeBuff_.RetrieveAll();
+    readBuff_.RetrieveAll();
+    writeBuff_.Release();
+    readBuff_.Release();
+}
+
 int HttpConn::GetFd() const {
     return fd_;
 };
@@ -62,6 +114,7 @@ int HttpConn::GetPort() const {
 // read操作
 ssize_t HttpConn::read(int *saveErrno) {
     ssize_t len = -1;
+    Wake_();
     do {
         len = readBuff_.ReadFd(fd_, saveErrno);
         if (len <= 0) {
@@ -71,56 +124,157 @@ ssize_t HttpConn::read(int *saveErrno) {
     return len;
 }
 
-// 写操作 利用分散写
+// 写操作 利用分散写，一次把队列中所有响应发出去
 ssize_t HttpConn::write(int *saveErrno) {
     ssize_t len = -1;
     do {
-        len = writev(fd_, iov_, iovCnt_);
-        if (len <= 0) {
-            *saveErrno = errno;
-            break;
-        }
-        if (iov_[0].iov_len + iov_[1].iov_len == 0) { break; } /* 传输结束 */
-        else if (static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t *) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if (iov_[0].iov_len) {
-                writeBuff_.RetrieveAll();
-                iov_[0].iov_len = 0;
+        if (iov_[iovIdx_].iov_base == nullptr) {
+            /* 文件段：由内核直接从页缓存拷贝到socket */
+            FileSeg &seg = files_[fileIdx_];
+            len = sendfile(fd_, seg.fd, &seg.offset, iov_[iovIdx_].iov_len);
+            if (len <= 0) {
+                *saveErrno = errno;
+                break;
+            }
+            iov_[iovIdx_].iov_len -= len;
+            if (iov_[iovIdx_].iov_len == 0) {
+                iovIdx_++;
+                fileIdx_++;
             }
         } else {
-            iov_[0].iov_base = (uint8_t *) iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
-            writeBuff_.Retrieve(len);
+            /* 内存段：连续的响应头和mmap文件合并成一次分散写，后面还有文件段时带上MSG_MORE */
+            size_t end = iovIdx_;
+            while (end < iov_.size() && iov_[end].iov_base) { end++; }
+            struct msghdr msg = {0};
+            msg.msg_iov = &iov_[iovIdx_];
+            msg.msg_iovlen = end - iovIdx_;
+            len = sendmsg(fd_, &msg, end < iov_.size() ? MSG_MORE : 0);
+            if (len <= 0) {
+                *saveErrno = errno;
+                break;
+            }
+            /* 跳过已经发完的iovec，调整发了一部分的那个 */
+            size_t left = len;
+            while (iovIdx_ < end && left >= iov_[iovIdx_].iov_len) {
+                left -= iov_[iovIdx_].iov_len;
+                iovIdx_++;
+            }
+            if (left > 0) {
+                iov_[iovIdx_].iov_base = (uint8_t *) iov_[iovIdx_].iov_base + left;
+                iov_[iovIdx_].iov_len -= left;
+            }
+        }
+        toWrite_ -= len;
+        if (toWrite_ == 0) {
+            /* 传输结束，立即释放映射和打开的文件 */
+            writeBuff_.RetrieveAll();
+            for (size_t i = 0; i < responseCnt_; i++) {
+                responses_[i]->UnmapFile();
+            }
+            break;
         }
     } while (isET || ToWriteBytes() > 10240);
     return len;
 }
 
+// 取出下一个可用的响应对象，对象在连接的生命周期内复用
+HttpResponse &HttpConn::NextResponse_() {
+    if (responseCnt_ == responses_.size()) {
+        responses_.emplace_back(new HttpResponse());
+    }
+    return *responses_[responseCnt_++];
+}
+
+/* 没有完整的请求，连接转入等待读的状态
+ * 长连接大多数时间都停在这里，缓冲区是空的就还给池子，收到下一个请求时再取 */
+void HttpConn::Idle_() {
+    Wake_();
+    if (releaseIdle && toWrite_ == 0) {
+        readBuff_.Release();
+        writeBuff_.Release();
+    }
+    idleHeld_ = readBuff_.Capacity() + writeBuff_.Capacity();
+    idleBytes += idleHeld_;
+}
+
+// 离开等待读的状态
+void HttpConn::Wake_() {
+    idleBytes -= idleHeld_;
+    idleHeld_ = 0;
+}
+
+// 追加一段待发送的数据，与上一段首尾相接时直接合并
+void HttpConn::AddIov_(const void *base, size_t len) {
+    if (len == 0) { return; }
+    if (!iov_.empty() && iov_.back().iov_base && (const uint8_t *) iov_.back().iov_base + iov_.back().iov_len == base) {
+        iov_.back().iov_len += len;
+    } else {
+        iov_.push_back({const_cast<void *>(base), len});
+    }
+    toWrite_ += len;
+}
+
+// 追加一段用sendfile发送的文件
+void HttpConn::AddFile_(int fileFd, size_t offset, size_t len) {
+    if (len == 0) { return; }
+    iov_.push_back({nullptr, len});
+    files_.push_back({fileFd, static_cast<off_t>(offset)});
+    toWrite_ += len;
+}
+
+// 解析读缓冲区中所有完整的请求(HTTP流水线)，按顺序生成响应
 bool HttpConn::process() {
-    request_.Init();
-    if (readBuff_.ReadableBytes() <= 0) {
+    responseCnt_ = 0;
+    while (responseCnt_ < MAX_PIPELINE) {
+        HttpRequest::HTTP_CODE ret = request_.parse(readBuff_);
+        if (ret == HttpRequest::NO_REQUEST) {
+            // 请求还不完整，继续读
+            break;
+        }
+        HttpResponse &response = NextResponse_();
+        if (ret == HttpRequest::GET_REQUEST) {
+            // 解析http请求，完成后给出response
+            LOG_DEBUG("%s", request_.path().c_str());
+            isKeepAlive_ = request_.IsKeepAlive();
+            response.Init(srcDir, request_.path(), isKeepAlive_, 200);
+            response.SetAcceptEncoding(request_.GetHeader("Accept-Encoding"), request_.version() == "1.1");
+            response.SetRange(request_.GetHeader("Range"), request_.GetHeader("If-Range"));
+            response.SetConditional(request_.GetHeader("If-None-Match"), request_.GetHeader("If-Modified-Since"));
+        } else {
+            // 错误请求之后的数据已经无法解析，回复400后关闭连接
+            readBuff_.RetrieveAll();
+            isKeepAlive_ = false;
+            response.Init(srcDir, request_.path(), false, 400);
+        }
+        response.MakeResponse(writeBuff_);
+        if (!isKeepAlive_) {
+            // 不保持连接时，之后的请求都不再处理
+            break;
+        }
+    }
+    if (responseCnt_ == 0) {
+        Idle_();
         return false;
-    } else if (request_.parse(readBuff_)) {
-        // 解析http请求，完成后给出response
-        LOG_DEBUG("%s", request_.path().c_str());
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
-    } else {
-        response_.Init(srcDir, request_.path(), false, 400);
     }
 
-    response_.MakeResponse(writeBuff_);
-    /* 响应头 */
-    iov_[0].iov_base = const_cast<char *>(writeBuff_.Peek());
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
-    iovCnt_ = 1;
-
-    /* 文件 */
-    if (response_.FileLen() > 0 && response_.File()) {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ = 2;
+    /* 写缓冲区中的数据不会搬移，响应头直接按块导出为iovec */
+    iov_.clear();
+    files_.clear();
+    iovIdx_ = fileIdx_ = toWrite_ = 0;
+    for (size_t i = 0; i < responseCnt_; i++) {
+        HttpResponse &response = *responses_[i];
+        for (const HttpResponse::Segment &seg: response.Segments()) {
+            if (seg.inBuff) {
+                /* 响应头、分段头等，可能跨块 */
+                toWrite_ += writeBuff_.Peek(response.BuffStart() + seg.offset, seg.len, iov_);
+            } else if (response.File()) {
+                /* 文件或其中的一段 */
+                AddIov_(response.File() + seg.offset, seg.len);
+            } else if (response.FileFd() >= 0) {
+                AddFile_(response.FileFd(), seg.offset, seg.len);
+            }
+        }
     }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen(), iovCnt_, ToWriteBytes());
+    LOG_DEBUG("responses:%d, iov:%d, to write:%d", (int) responseCnt_, (int) iov_.size(), ToWriteBytes());
     return true;
 }
@@ -9,13 +9,20 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>     // readv/writev
+#include <sys/socket.h>  // sendmsg
+#include <sys/sendfile.h>
 #include <arpa/inet.h>   // sockaddr_in
 #include <stdlib.h>      // atoi()
 #include <errno.h>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
 
 #include "../log/log.h"
 #include "../pool/sqlconnRAII.h"
 #include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 #include "httprequest.h"
 #include "httpresponse.h"
 
@@ -44,32 +51,79 @@ public:
     bool process();
 
     int ToWriteBytes() {
-        return iov_[0].iov_len + iov_[1].iov_len;
+        return toWrite_;
+    }
+
+    // 读缓冲区中下一个请求要查询数据库
+    bool NeedsDb() const {
+        return HttpRequest::IsDbRequest(readBuff_.Peek(), readBuff_.BeginWriteConst());
+    }
+
+    bool IsClose() const {
+        return isClose_;
     }
 
     bool IsKeepAlive() const {
-        return request_.IsKeepAlive();
+        return isKeepAlive_;
     }
 
+    /* 线程池中的任务在提交前Pin、执行完Unpin，连接关闭后Pin失败。
+     * 关闭时还有任务持有连接，文件和缓冲区由最后一个Unpin的线程释放，不会在任务使用时被释放 */
+    bool Pin();
+
+    void Unpin();
+
     static bool isET;
+    static bool releaseIdle;    // 等待下一个请求时把缓冲区内存还给池子
     static const char *srcDir;  // 资源地址
     static std::atomic<int> userCount;  // 用户数量
+    static std::atomic<size_t> idleBytes;  // 等待下一个请求的连接占用的缓冲区字节数
 
 private:
+    HttpResponse &NextResponse_();
+
+    void AddIov_(const void *base, size_t len);
+
+    void AddFile_(int fileFd, size_t offset, size_t len);
+
+    void Idle_();
+
+    void Wake_();
+
+    void ReleaseResources_();
+
+    static const uint32_t CLOSED = 1u << 31;  // pins_的最高位表示已关闭，其余为持有连接的任务数
+
+    static const int MAX_PIPELINE = 16;   // 一次最多处理的流水线请求数
 
     int fd_;    // http连接对应的fd
     struct sockaddr_in addr_;  // 网络地址
 
     bool isClose_;  // 是否关闭
-
-    int iovCnt_;    // 用于分散写以及分散读
-    struct iovec iov_[2];
+    bool isKeepAlive_;  // 最后一个请求是否保持连接
+
+    // sendfile发送的文件段，对应iov_中iov_base为nullptr的项
+    struct FileSeg {
+        int fd;
+        off_t offset;
+    };
+
+    /* 待发送的响应队列：按请求顺序排列的响应头和文件
+     * 相邻的内存段一次writev发出，大文件段用sendfile发送 */
+    std::vector<struct iovec> iov_;
+    std::vector<FileSeg> files_;
+    size_t iovIdx_;     // 第一个还没发完的iovec
+    size_t fileIdx_;    // 第一个还没发完的文件段
+    size_t toWrite_;    // 还没发送的字节数
 
     Buffer readBuff_; // 读缓冲区
-    Buffer writeBuff_; // 写缓冲区
+    ChainBuffer writeBuff_; // 写缓冲区，响应头按块追加，已写入的数据不搬移
 
     HttpRequest request_;   // http请求
-    HttpResponse response_; // http响应
+    std::vector<std::unique_ptr<HttpResponse>> responses_; // http响应，按流水线请求的顺序复用
+    size_t responseCnt_;    // 当前批次中的响应数
+    size_t idleHeld_;       // 空闲时仍占用的缓冲区字节数，计入idleBytes
+    std::atomic<uint32_t> pins_;
 };
 
 
@@ -19,114 +19,211 @@ const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG{
 
 // 初始化
 void HttpRequest::Init() {
-    method_ = path_ = version_ = body_ = "";
+    method_ = version_ = Span{0, 0};
+    path_.clear();
+    body_.clear();
     state_ = REQUEST_LINE;
-    header_.clear();
+    base_ = nullptr;
+    parsed_ = checked_ = 0;
+    contentLength_ = 0;
+    headerCnt_ = 0;
     post_.clear();
 }
 
+// 不区分大小写比较
+static bool EqualsIgnoreCase(string_view a, string_view b) {
+    if (a.size() != b.size()) { return false; }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // 判断是否保持初始化
 bool HttpRequest::IsKeepAlive() const {
-    if (header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+    return EqualsIgnoreCase(GetHeader("Connection"), "keep-alive") && version() == "1.1";
+}
+
+string_view HttpRequest::GetHeader(string_view name) const {
+    for (int i = 0; i < headerCnt_; i++) {
+        if (EqualsIgnoreCase(View_(header_[i].first), name)) {
+            return View_(header_[i].second);
+        }
     }
-    return false;
+    return string_view();
+}
+
+HttpRequest::Span HttpRequest::MakeSpan_(const char *begin, const char *end) const {
+    return Span{static_cast<uint32_t>(begin - base_), static_cast<uint32_t>(end - begin)};
+}
+
+string_view HttpRequest::View_(const Span &span) const {
+    return base_ ? string_view(base_ + span.off, span.len) : string_view();
 }
 
 // 解析http请求 使用有限状态机 请求行->请求头->请求体
-bool HttpRequest::parse(Buffer &buff) {
-    const char CRLF[] = "\r\n";
+// 直接在buff的字节上逐行解析，请求不完整时保留状态，下次读到更多数据后从上次的位置继续
+HttpRequest::HTTP_CODE HttpRequest::parse(Buffer &buff) {
+    if (state_ == FINISH) {
+        // 上一个请求已经处理完，开始解析新的请求
+        Init();
+    }
     if (buff.ReadableBytes() <= 0) {
-        return false;
+        return NO_REQUEST;
     }
-    while (buff.ReadableBytes() && state_ != FINISH) {
-        // 在buff中找到\r\n 即找到一行的末尾
-        const char *lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
-        std::string line(buff.Peek(), lineEnd);
+    // 请求完整之前不会从buff中取走数据，缓冲区即使搬移过，请求也仍从Peek()开始
+    base_ = buff.Peek();
+    const char *end = buff.BeginWriteConst();
+    while (state_ != FINISH) {
+        const char *p = base_ + parsed_;
+        if (state_ == BODY) {
+            // 请求体收齐之后再解析
+            if (static_cast<size_t>(end - p) < contentLength_) {
+                return NO_REQUEST;
+            }
+            ParseBody_(p, p + contentLength_);
+            parsed_ += contentLength_;
+            break;
+        }
+        // 在buff中找到\r\n 即找到一行的末尾，已经找过的字节不再重复扫描
+        const char *lineEnd = FindCRLF_(base_ + std::max(parsed_, checked_), end);
+        if (!lineEnd) {
+            checked_ = std::max(parsed_, static_cast<size_t>(end - base_) - 1);
+            if (static_cast<size_t>(end - base_) > MAX_HEADER_SIZE) {
+                LOG_ERROR("Header too large");
+                return BAD_REQUEST;
+            }
+            return NO_REQUEST;
+        }
         switch (state_) {
             case REQUEST_LINE:
                 // 解析请求行
-                if (!ParseRequestLine_(line)) {
-                    return false;
+                if (!ParseRequestLine_(p, lineEnd)) {
+                    return BAD_REQUEST;
                 }
                 // 解析路径
                 ParsePath_();
                 break;
             case HEADERS:
-                // 解析头部信息
-                ParseHeader_(line);
-                if (buff.ReadableBytes() <= 2) {
-                    state_ = FINISH;
+                // 空行表示请求头结束
+                if (p == lineEnd) {
+                    if (contentLength_ > MAX_BODY_SIZE) {
+                        LOG_ERROR("Body too large");
+                        return BAD_REQUEST;
+                    }
+                    state_ = contentLength_ > 0 ? BODY : FINISH;
+                } else if (!ParseHeader_(p, lineEnd)) {
+                    return BAD_REQUEST;
                 }
                 break;
-            case BODY:
-                // 解析body信息
-                ParseBody_(line);
-                break;
             default:
                 break;
         }
-        // TODO：
-        if (lineEnd == buff.BeginWrite()) { break; }
-        buff.RetrieveUntil(lineEnd + 2);
+        parsed_ = checked_ = lineEnd + 2 - base_;
     }
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
-    return true;
+    // 取走这个请求的字节，数据仍留在缓冲区中，生成响应期间依旧可以引用
+    buff.Retrieve(parsed_);
+    LOG_DEBUG("[%.*s], [%s], [%.*s]", (int) method_.len, base_ + method_.off, path_.c_str(),
+              (int) version_.len, base_ + version_.off);
+    return GET_REQUEST;
+}
+
+bool HttpRequest::IsDbRequest(const char *begin, const char *end) {
+    const char *lineEnd = FindCRLF_(begin, end);
+    if (!lineEnd || lineEnd - begin < 5 || memcmp(begin, "POST ", 5) != 0) {
+        return false;
+    }
+    const char *pathBegin = begin + 5;
+    const char *pathEnd = static_cast<const char *>(memchr(pathBegin, ' ', lineEnd - pathBegin));
+    if (!pathEnd) { return false; }
+    string_view path(pathBegin, pathEnd - pathBegin);
+    for (const auto &tag: DEFAULT_HTML_TAG) {
+        // "/login.html"，或者不带.html后缀的"/login"
+        string_view html(tag.first);
+        if (path == html || path == html.substr(0, html.size() - 5)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 查找\r\n，没有找到返回nullptr
+const char *HttpRequest::FindCRLF_(const char *begin, const char *end) {
+    const char *p = begin;
+    while (p < end) {
+        p = static_cast<const char *>(memchr(p, '\r', end - p));
+        if (!p || p + 1 >= end) { return nullptr; }
+        if (p[1] == '\n') { return p; }
+        p++;
+    }
+    return nullptr;
 }
 
 // 解析请求路径
 void HttpRequest::ParsePath_() {
     if (path_ == "/") {
         path_ = "/index.html";
-    } else {
+    } else if (DEFAULT_HTML.count(path_)) {
         // 匹配对应的html页面
-        for (auto &item: DEFAULT_HTML) {
-            if (item == path_) {
-                path_ += ".html";
-                break;
-            }
-        }
+        path_ += ".html";
     }
 }
 
 // 解析请求行
 /**
  * 请求行例子：GET  /index.htm  HTTP/1.1 请求方法 路径 HTTP版本号
- * @param line
+ * @param begin 行首
+ * @param end 行尾(\r\n的位置)
  * @return
  */
-bool HttpRequest::ParseRequestLine_(const string &line) {
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch subMatch;
-    // 正则匹配到方法名、路径名、版本号
-    if (regex_match(line, subMatch, patten)) {
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        state_ = HEADERS;
-        return true;
+bool HttpRequest::ParseRequestLine_(const char *begin, const char *end) {
+    const char *methodEnd = static_cast<const char *>(memchr(begin, ' ', end - begin));
+    if (methodEnd && methodEnd != begin) {
+        const char *pathBegin = methodEnd + 1;
+        const char *pathEnd = static_cast<const char *>(memchr(pathBegin, ' ', end - pathBegin));
+        if (pathEnd && pathEnd != pathBegin && end - pathEnd > 5 && memcmp(pathEnd + 1, "HTTP/", 5) == 0
+            && !memchr(pathEnd + 6, ' ', end - pathEnd - 6)) {
+            // 方法名、路径名、版本号
+            method_ = MakeSpan_(begin, methodEnd);
+            path_.assign(pathBegin, pathEnd);
+            version_ = MakeSpan_(pathEnd + 6, end);
+            state_ = HEADERS;
+            return true;
+        }
     }
     LOG_ERROR("RequestLine Error");
     return false;
 }
 
-// 解析请求头
-void HttpRequest::ParseHeader_(const string &line) {
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
-    if (regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
-    } else {
-        state_ = BODY;
+// 解析请求头 name: value
+bool HttpRequest::ParseHeader_(const char *begin, const char *end) {
+    const char *colon = static_cast<const char *>(memchr(begin, ':', end - begin));
+    if (!colon || colon == begin || headerCnt_ >= MAX_HEADERS) {
+        LOG_ERROR("Header Error");
+        return false;
+    }
+    const char *value = colon + 1;
+    while (value < end && (*value == ' ' || *value == '\t')) { value++; }
+    const char *valueEnd = end;
+    while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) { valueEnd--; }
+
+    header_[headerCnt_].first = MakeSpan_(begin, colon);
+    header_[headerCnt_].second = MakeSpan_(value, valueEnd);
+    headerCnt_++;
+    if (EqualsIgnoreCase(string_view(begin, colon - begin), "Content-Length")) {
+        contentLength_ = strtoul(value, nullptr, 10);
     }
+    return true;
 }
 
 // 解析请求体
-void HttpRequest::ParseBody_(const string &line) {
-    body_ = line;
+void HttpRequest::ParseBody_(const char *begin, const char *end) {
+    body_.assign(begin, end);
     ParsePost_();
     state_ = FINISH;
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
+    LOG_DEBUG("Body:%s, len:%d", body_.c_str(), body_.size());
 }
 
 // 转换16进制数据到10进制
@@ -138,7 +235,7 @@ int HttpRequest::ConverHex(char ch) {
 
 // 解析post请求
 void HttpRequest::ParsePost_() {
-    if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    if (method() == "POST" && GetHeader("Content-Type") == "application/x-www-form-urlencoded") {
         ParseFromUrlencoded_();
         if (DEFAULT_HTML_TAG.count(path_)) {
             int tag = DEFAULT_HTML_TAG.find(path_)->second;
@@ -266,12 +363,12 @@ std::string &HttpRequest::path() {
     return path_;
 }
 
-std::string HttpRequest::method() const {
-    return method_;
+std::string_view HttpRequest::method() const {
+    return View_(method_);
 }
 
-std::string HttpRequest::version() const {
-    return version_;
+std::string_view HttpRequest::version() const {
+    return View_(version_);
 }
 
 std::string HttpRequest::GetPost(const std::string &key) const {
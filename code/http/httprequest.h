@@ -9,7 +9,8 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <algorithm>
 #include <errno.h>
 #include <mysql/mysql.h>  //mysql
 
@@ -46,16 +47,21 @@ public:
 
     void Init();
 
-    // 解析request
-    bool parse(Buffer &buff);
+    /* 解析request，可以跨多次read增量解析
+     * 返回NO_REQUEST表示请求还不完整，GET_REQUEST表示得到一个完整请求(已从buff中取走)，
+     * BAD_REQUEST表示请求格式错误 */
+    HTTP_CODE parse(Buffer &buff);
 
     std::string path() const;
 
     std::string &path();
 
-    std::string method() const;
+    std::string_view method() const;
 
-    std::string version() const;
+    std::string_view version() const;
+
+    // 按名字查找请求头(不区分大小写)，不存在时返回空
+    std::string_view GetHeader(std::string_view name) const;
 
     std::string GetPost(const std::string &key) const;
 
@@ -63,6 +69,9 @@ public:
 
     bool IsKeepAlive() const;
 
+    // [begin, end)开头的请求行是否为要查询数据库的登录/注册请求，只看请求行，不改变解析状态
+    static bool IsDbRequest(const char *begin, const char *end);
+
     /* 
     todo 
     void HttpConn::ParseFormData() {}
@@ -70,11 +79,13 @@ public:
     */
 
 private:
-    bool ParseRequestLine_(const std::string &line);
+    static const char *FindCRLF_(const char *begin, const char *end);
 
-    void ParseHeader_(const std::string &line);
+    bool ParseRequestLine_(const char *begin, const char *end);
 
-    void ParseBody_(const std::string &line);
+    bool ParseHeader_(const char *begin, const char *end);
+
+    void ParseBody_(const char *begin, const char *end);
 
     void ParsePath_();
 
@@ -84,9 +95,31 @@ private:
 
     static bool UserVerify(const std::string &name, const std::string &pwd, bool isLogin);
 
+    // 相对请求起始位置的偏移，读缓冲区扩容或整理后依然有效
+    struct Span {
+        uint32_t off;
+        uint32_t len;
+    };
+
+    Span MakeSpan_(const char *begin, const char *end) const;
+
+    std::string_view View_(const Span &span) const;
+
+    static const int MAX_HEADERS = 32;
+    static const size_t MAX_HEADER_SIZE = 64 * 1024;
+    static const size_t MAX_BODY_SIZE = 8 * 1024 * 1024;
+
+    /* method、version和请求头都直接引用读缓冲区中的字节，解析过程不分配内存；
+     * path_和body_在解析后还会被改写，因此单独保存，Init时保留容量以便复用 */
     PARSE_STATE state_;
-    std::string method_, path_, version_, body_;
-    std::unordered_map <std::string, std::string> header_;
+    const char *base_;  // 当前请求在读缓冲区中的起始位置，每次parse时刷新
+    size_t parsed_;     // 已经解析完的字节数
+    size_t checked_;    // 已经查找过\r\n的字节数，下次从这里继续
+    Span method_, version_;
+    std::string path_, body_;
+    size_t contentLength_;
+    int headerCnt_;
+    std::pair<Span, Span> header_[MAX_HEADERS];
     std::unordered_map <std::string, std::string> post_;
 
     static const std::unordered_set <std::string> DEFAULT_HTML;
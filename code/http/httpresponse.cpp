@@ -7,47 +7,31 @@
 
 using namespace std;
 
-const unordered_map <string, string> HttpResponse::SUFFIX_TYPE = {
-        {".html",  "text/html"},
-        {".xml",   "text/xml"},
-        {".xhtml", "application/xhtml+xml"},
-        {".txt",   "text/plain"},
-        {".rtf",   "application/rtf"},
-        {".pdf",   "application/pdf"},
-        {".word",  "application/nsword"},
-        {".png",   "image/png"},
-        {".gif",   "image/gif"},
-        {".jpg",   "image/jpeg"},
-        {".jpeg",  "image/jpeg"},
-        {".au",    "audio/basic"},
-        {".mpeg",  "video/mpeg"},
-        {".mpg",   "video/mpeg"},
-        {".avi",   "video/x-msvideo"},
-        {".gz",    "application/x-gzip"},
-        {".tar",   "application/x-tar"},
-        {".css",   "text/css "},
-        {".js",    "text/javascript "},
-};
+size_t HttpResponse::sendfileThreshold = 64 * 1024;
 
-const unordered_map<int, string> HttpResponse::CODE_STATUS = {
-        {200, "OK"},
-        {400, "Bad Request"},
-        {403, "Forbidden"},
-        {404, "Not Found"},
-};
+shared_ptr<const FileEntry> HttpResponse::errorPages_[HttpTables::STATUS_NUM][2];
 
-const unordered_map<int, string> HttpResponse::CODE_PATH = {
-        {400, "/400.html"},
-        {403, "/403.html"},
-        {404, "/404.html"},
+char HttpResponse::date_[2][DATE_LEN + 1];
+atomic<int> HttpResponse::dateIdx_(0);
+atomic<time_t> HttpResponse::dateSec_(0);
+
+// 预压缩变体的后缀与Content-Encoding，按优先级排列
+static const struct {
+    FileEntry::Encoding encoding;
+    const char *suffix;
+    const char *name;
+} ENCODINGS[] = {
+        {FileEntry::BR,   ".br", "br"},
+        {FileEntry::GZIP, ".gz", "gzip"},
 };
 
 HttpResponse::HttpResponse() {
     code_ = -1;
+    acceptEncoding_ = 0;
+    allowChunked_ = false;
+    start_ = mark_ = 0;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
-    mmFile_ = nullptr;
-    mmFileStat_ = {0};
 };
 
 HttpResponse::~HttpResponse() {
@@ -58,130 +42,588 @@ HttpResponse::~HttpResponse() {
 void HttpResponse::Init(const string &srcDir, string &path, bool isKeepAlive, int code) {
     assert(srcDir != "");
     // TODO：注意这里 是因为会复用嘛？？
-    if (mmFile_) { UnmapFile(); }
+    UnmapFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
+    acceptEncoding_ = 0;
+    allowChunked_ = false;
+    range_.clear();
+    ifRange_.clear();
+    ifNoneMatch_.clear();
+    ifModifiedSince_.clear();
     path_ = path;
     srcDir_ = srcDir;
-    mmFile_ = nullptr;
-    mmFileStat_ = {0};
 }
 
 // 返回请求
-void HttpResponse::MakeResponse(Buffer &buff) {
-    /* 判断请求的资源文件 */
-    if (stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
-        code_ = 404;
-    } else if (!(mmFileStat_.st_mode & S_IROTH)) {
-        code_ = 403;
-    } else if (code_ == -1) {
-        code_ = 200;
-    }
-    ErrorHtml_();
+void HttpResponse::MakeResponse(ChainBuffer &buff) {
+    start_ = buff.ReadableBytes();
+    mark_ = 0;
+    segments_.clear();
+    if (code_ == 200 && NotModified_(buff)) {
+        /* 只用元数据就能确定客户端的缓存仍然有效，不需要打开文件 */
+        return;
+    }
+    if (code_ == 200 || code_ == -1) {
+        /* 判断请求的资源文件，命中缓存时不需要任何文件系统调用 */
+        file_ = FileCache::Instance()->Get(path_);
+        if (!file_) {
+            code_ = 404;
+        } else if (!file_->Readable()) {
+            code_ = 403;
+        } else {
+            code_ = 200;
+        }
+    }
+    if (ErrorHtml_()) {
+        /* 错误页面和它的响应头都在内存中准备好了 */
+        AddStateLine_(buff);
+        AddHeader_(buff);
+        AddContent_(buff);
+        return;
+    }
+    if (!Range_()) {
+        /* 分段请求按原始内容计算范围，不做压缩 */
+        Negotiate_();
+    }
+    if (code_ == 200 && !ifNoneMatch_.empty() && EtagMatch_(file_->etag)) {
+        /* 协商后选中的是压缩版本，按它的ETag比较 */
+        code_ = 304;
+        AddStateLine_(buff);
+        AddHeader_(buff);
+        AddNotModified_(buff, file_->etag, file_->lastModified, file_->headers.find("Vary:") != string::npos);
+        file_.reset();
+        return;
+    }
     AddStateLine_(buff);
     AddHeader_(buff);
     AddContent_(buff);
 }
 
 char *HttpResponse::File() {
-    return mmFile_;
+    return file_ ? file_->data : nullptr;
 }
 
 size_t HttpResponse::FileLen() const {
-    return mmFileStat_.st_size;
+    return file_ ? file_->st.st_size : 0;
 }
 
 // 错误页面
-void HttpResponse::ErrorHtml_() {
-    if (CODE_PATH.count(code_) == 1) {
-        path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+bool HttpResponse::ErrorHtml_() {
+    int index = HttpTables::StatusOf(code_);
+    if (index < 0 || HttpTables::STATUSES[index].page.empty()) {
+        return false;
+    }
+    shared_ptr<const FileEntry> gzip;
+    if ((acceptEncoding_ & FileEntry::GZIP) && Deflater::level > 0) {
+        gzip = atomic_load(&errorPages_[index][1]);
+    }
+    file_ = gzip ? gzip : atomic_load(&errorPages_[index][0]);
+    return file_ != nullptr;
+}
+
+// 读入资源目录中的错误页面，不存在时用生成的页面；同时准备好gzip版本
+void HttpResponse::LoadErrorPages(const string &srcDir) {
+    for (size_t index = 0; index < HttpTables::STATUS_NUM; index++) {
+        const HttpTables::Status &status = HttpTables::STATUSES[index];
+        if (status.page.empty()) { continue; }
+
+        string body;
+        int fd = open((srcDir + string(status.page)).data(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            char buff[4096];
+            ssize_t len;
+            while ((len = read(fd, buff, sizeof(buff))) > 0) {
+                body.append(buff, len);
+            }
+            close(fd);
+            if (len < 0) { body.clear(); }
+        }
+        if (body.empty()) {
+            body = ErrorBody_(status.code, string(status.text));
+        }
+
+        shared_ptr<FileEntry> page = make_shared<FileEntry>();
+        page->body = std::move(body);
+        shared_ptr<FileEntry> gzip = make_shared<FileEntry>();
+        if (!Deflater::Local()->Gzip(page->body.data(), page->body.size(), gzip->body) ||
+            gzip->body.size() >= page->body.size()) {
+            gzip.reset();
+        }
+        for (FileEntry *entry: {page.get(), gzip.get()}) {
+            if (!entry) { continue; }
+            memset(&entry->st, 0, sizeof(entry->st));
+            entry->st.st_mode = S_IFREG | S_IROTH;
+            entry->st.st_size = entry->body.size();
+            entry->data = &entry->body[0];
+            entry->ownsData = false;
+            entry->mimeType = "text/html";
+            entry->encoding = entry == gzip.get() ? "gzip" : "";
+            entry->headers = "Content-type: text/html\r\n";
+            if (!entry->encoding.empty()) {
+                entry->headers += "Content-Encoding: gzip\r\n";
+            }
+            entry->headers += "Vary: Accept-Encoding\r\nContent-length: " + to_string(entry->body.size()) + "\r\n\r\n";
+        }
+        atomic_store(&errorPages_[index][0], shared_ptr<const FileEntry>(page));
+        atomic_store(&errorPages_[index][1], shared_ptr<const FileEntry>(gzip));
+    }
+}
+
+// Accept-Encoding: gzip, deflate, br;q=1.0, identity;q=0
+void HttpResponse::SetAcceptEncoding(string_view acceptEncoding, bool allowChunked) {
+    acceptEncoding_ = 0;
+    allowChunked_ = allowChunked;
+    while (!acceptEncoding.empty()) {
+        size_t end = acceptEncoding.find(',');
+        string_view item = acceptEncoding.substr(0, end);
+        acceptEncoding.remove_prefix(end == string_view::npos ? acceptEncoding.size() : end + 1);
+
+        size_t semi = item.find(';');
+        string_view coding = item.substr(0, semi);
+        while (!coding.empty() && (coding.front() == ' ' || coding.front() == '\t')) { coding.remove_prefix(1); }
+        while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t')) { coding.remove_suffix(1); }
+        if (semi != string_view::npos) {
+            /* q=0表示明确不接受，q值的其他差别不做区分 */
+            string_view param = item.substr(semi + 1);
+            size_t q = param.find("q=");
+            if (q != string_view::npos) {
+                string_view value = param.substr(q + 2);
+                size_t digit = value.find_first_not_of("0.");
+                if (digit == string_view::npos || value[digit] == ' ' || value[digit] == ';') {
+                    continue;
+                }
+            }
+        }
+        for (const auto &enc: ENCODINGS) {
+            if (coding.size() == strlen(enc.name) && strncasecmp(coding.data(), enc.name, coding.size()) == 0) {
+                acceptEncoding_ |= enc.encoding;
+            }
+        }
+        if (coding == "*") {
+            acceptEncoding_ |= FileEntry::GZIP | FileEntry::BR;
+        }
+    }
+}
+
+// 内容协商：优先发送客户端接受的预压缩变体，没有时即时gzip压缩并缓存结果
+void HttpResponse::Negotiate_() {
+    if (!file_ || !file_->Readable() || !file_->encoding.empty() || !acceptEncoding_) {
+        return;
+    }
+    for (const auto &enc: ENCODINGS) {
+        if (!(file_->variants & acceptEncoding_ & enc.encoding)) { continue; }
+        shared_ptr<const FileEntry> variant = FileCache::Instance()->Get(path_ + enc.suffix);
+        if (variant && variant->Readable() && !variant->encoding.empty()) {
+            file_ = std::move(variant);
+            return;
+        }
+    }
+    if ((acceptEncoding_ & FileEntry::GZIP) && IsCompressible(path_) && Deflater::Worth(file_->st.st_size)) {
+        shared_ptr<const FileEntry> gzip = FileCache::Instance()->GetGzip(path_, file_);
+        if (gzip) {
+            file_ = std::move(gzip);
+        }
     }
 }
 
 // 增加响应行
-void HttpResponse::AddStateLine_(Buffer &buff) {
-    string status;
-    if (CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    } else {
+void HttpResponse::AddStateLine_(ChainBuffer &buff) {
+    int index = HttpTables::StatusOf(code_);
+    if (index < 0) {
         code_ = 400;
-        status = CODE_STATUS.find(400)->second;
+        index = HttpTables::StatusOf(code_);
     }
-    buff.Append("HTTP/1.1 " + to_string(code_) + " " + status + "\r\n");
+    buff.Append(HeadTemplates_()[index].head[isKeepAlive_]);
 }
 
-// 添加响应头
-void HttpResponse::AddHeader_(Buffer &buff) {
-    buff.Append("Connection: ");
-    if (isKeepAlive_) {
-        buff.Append("keep-alive\r\n");
-        buff.Append("keep-alive: max=6, timeout=120\r\n");
-    } else {
-        buff.Append("close\r\n");
+// 添加响应头，状态行模板之外只有Date需要每次写入
+void HttpResponse::AddHeader_(ChainBuffer &buff) {
+    if (dateSec_.load(memory_order_acquire) == 0) {
+        UpdateDate();
     }
-    buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    buff.Append(date_[dateIdx_.load(memory_order_acquire)], DATE_LEN);
 }
 
-// 添加响应体
-void HttpResponse::AddContent_(Buffer &buff) {
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
-    if (srcFd < 0) {
-        ErrorContent(buff, "File NotFound!");
+// 每种状态码和连接方式预先拼好的状态行与Connection头
+const HttpResponse::HeadTemplate *HttpResponse::HeadTemplates_() {
+    static const vector<HeadTemplate> templates = [] {
+        vector<HeadTemplate> res(HttpTables::STATUS_NUM);
+        for (size_t index = 0; index < HttpTables::STATUS_NUM; index++) {
+            const HttpTables::Status &status = HttpTables::STATUSES[index];
+            string line = "HTTP/1.1 " + to_string(status.code) + " " + string(status.text) + "\r\n";
+            res[index].head[0] = line + "Connection: close\r\n";
+            res[index].head[1] = line + "Connection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n";
+        }
+        return res;
+    }();
+    return templates.data();
+}
+
+// 秒数变化时把新的Date头写到另一个槽再切换，读者拿到的槽在一秒内不会被改写
+void HttpResponse::UpdateDate() {
+    time_t now = time(nullptr);
+    time_t last = dateSec_.load(memory_order_relaxed);
+    if (now == last || !dateSec_.compare_exchange_strong(last, now)) {
+        /* 没有变化，或者其他线程正在更新 */
         return;
     }
+    int next = dateIdx_.load(memory_order_relaxed) ^ 1;
+    snprintf(date_[next], sizeof(date_[next]), "Date: %s\r\n", HttpDate(now).data());
+    dateIdx_.store(next, memory_order_release);
+}
 
-    /* 将文件映射到内存提高文件的访问速度 
-        MAP_PRIVATE 建立一个写入时拷贝的私有映射*/
-    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
-    // mmap映射
-    int *mmRet = (int *) mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if (*mmRet == -1) {
+// 不经过std::string把十进制数追加到缓冲区
+void HttpResponse::AppendNum_(ChainBuffer &buff, size_t value) {
+    char digits[20];
+    char *p = digits + sizeof(digits);
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    buff.Append(p, digits + sizeof(digits) - p);
+}
+
+// 添加响应体，Content-type和Content-length在缓存项中已经生成好
+void HttpResponse::AddContent_(ChainBuffer &buff) {
+    if (code_ == 416) {
+        buff.Append("Content-Range: bytes */");
+        AppendNum_(buff, file_->st.st_size);
+        buff.Append("\r\nContent-length: 0\r\n\r\n");
+        MarkBuff_(buff);
+        return;
+    }
+    if (code_ == 206) {
+        AddRangeContent_(buff);
+        return;
+    }
+    if (!file_ || !file_->Readable()) {
+        buff.Append("Content-type: text/html\r\n");
         ErrorContent(buff, "File NotFound!");
+        MarkBuff_(buff);
         return;
     }
-    mmFile_ = (char *) mmRet;
-    close(srcFd);
-    buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
+    buff.Append(file_->headers);
+    MarkBuff_(buff);
+    MarkFile_(0, file_->st.st_size);
 }
 
-// 取消mmap映射
-void HttpResponse::UnmapFile() {
-    if (mmFile_) {
-        munmap(mmFile_, mmFileStat_.st_size);
-        mmFile_ = nullptr;
+void HttpResponse::SetRange(string_view range, string_view ifRange) {
+    range_.assign(range.data(), range.size());
+    ifRange_.assign(ifRange.data(), ifRange.size());
+}
+
+void HttpResponse::SetConditional(string_view ifNoneMatch, string_view ifModifiedSince) {
+    ifNoneMatch_.assign(ifNoneMatch.data(), ifNoneMatch.size());
+    ifModifiedSince_.assign(ifModifiedSince.data(), ifModifiedSince.size());
+}
+
+// 在加载文件之前处理条件请求，命中时直接写出304响应
+bool HttpResponse::NotModified_(ChainBuffer &buff) {
+    if (ifNoneMatch_.empty() && ifModifiedSince_.empty()) {
+        return false;
+    }
+    struct stat st;
+    if (!FileCache::Instance()->Stat(path_, st) || !(st.st_mode & S_IROTH)) {
+        return false;
+    }
+    string etag = MakeETag(st, "");
+    if (!ifNoneMatch_.empty()) {
+        /* 有If-None-Match时忽略If-Modified-Since；压缩版本的ETag在协商之后再比较 */
+        if (!EtagMatch_(etag)) { return false; }
+    } else {
+        struct tm tm = {};
+        const char *end = strptime(ifModifiedSince_.data(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        if (!end || *end != '\0' || st.st_mtime > timegm(&tm)) { return false; }
+    }
+    code_ = 304;
+    AddStateLine_(buff);
+    AddHeader_(buff);
+    AddNotModified_(buff, etag, HttpDate(st.st_mtime), IsCompressible(path_));
+    return true;
+}
+
+// If-None-Match: "a", W/"b" 或 *，按弱比较
+bool HttpResponse::EtagMatch_(const string &etag) const {
+    string_view list = ifNoneMatch_;
+    while (!list.empty()) {
+        size_t end = list.find(',');
+        string_view item = list.substr(0, end);
+        list.remove_prefix(end == string_view::npos ? list.size() : end + 1);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) { item.remove_prefix(1); }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) { item.remove_suffix(1); }
+        if (item.compare(0, 2, "W/") == 0) { item.remove_prefix(2); }
+        if (item == "*" || item == etag) {
+            return true;
+        }
     }
+    return false;
+}
+
+// 304响应只有校验值，没有响应体
+void HttpResponse::AddNotModified_(ChainBuffer &buff, const string &etag, const string &lastModified, bool vary) {
+    buff.Append("ETag: " + etag + "\r\n");
+    buff.Append("Last-Modified: " + lastModified + "\r\n");
+    if (vary) {
+        buff.Append("Vary: Accept-Encoding\r\n");
+    }
+    buff.Append("\r\n");
+    MarkBuff_(buff);
+}
+
+// 处理Range头，返回true表示响应为206或416
+bool HttpResponse::Range_() {
+    if (range_.empty() || code_ != 200 || !file_ || !file_->Readable()) {
+        return false;
+    }
+    if (!ifRange_.empty() && ifRange_ != file_->etag && ifRange_ != file_->lastModified) {
+        /* 客户端已有的部分内容已经过期，发送整个文件 */
+        return false;
+    }
+    if (!ParseRange_(file_->st.st_size)) {
+        /* 无法识别的Range按没有处理 */
+        return false;
+    }
+    code_ = ranges_.empty() ? 416 : 206;
+    return true;
+}
+
+// 解析十进制的字节位置
+static bool ParseOffset(string_view str, size_t &value) {
+    if (str.empty() || str.size() > 19) { return false; }
+    value = 0;
+    for (char ch: str) {
+        if (ch < '0' || ch > '9') { return false; }
+        value = value * 10 + (ch - '0');
+    }
+    return true;
+}
+
+// Range: bytes=0-499, 1000-, -200
+// 语法错误或段数过多时返回false；没有可满足的段时ranges_为空
+bool HttpResponse::ParseRange_(size_t size) {
+    ranges_.clear();
+    string_view spec = range_;
+    if (spec.compare(0, 6, "bytes=") != 0) {
+        return false;
+    }
+    spec.remove_prefix(6);
+    size_t count = 0;
+    while (!spec.empty()) {
+        size_t end = spec.find(',');
+        string_view item = spec.substr(0, end);
+        spec.remove_prefix(end == string_view::npos ? spec.size() : end + 1);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) { item.remove_prefix(1); }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) { item.remove_suffix(1); }
+        if (item.empty()) { continue; }
+        if (++count > MAX_RANGES) { return false; }
+
+        size_t dash = item.find('-');
+        if (dash == string_view::npos) { return false; }
+        string_view first = item.substr(0, dash);
+        string_view last = item.substr(dash + 1);
+        size_t from, to;
+        if (first.empty()) {
+            /* 最后n个字节 */
+            size_t n;
+            if (!ParseOffset(last, n)) { return false; }
+            if (n == 0 || size == 0) { continue; }
+            from = n >= size ? 0 : size - n;
+            to = size - 1;
+        } else {
+            if (!ParseOffset(first, from)) { return false; }
+            if (last.empty()) {
+                to = size - 1;
+            } else if (!ParseOffset(last, to) || to < from) {
+                return false;
+            }
+            if (from >= size) { continue; }
+            if (to >= size) { to = size - 1; }
+        }
+        ranges_.emplace_back(from, to);
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    /* 重叠或相邻的段合并成一段 */
+    sort(ranges_.begin(), ranges_.end());
+    size_t n = 0;
+    for (size_t i = 0; i < ranges_.size(); i++) {
+        if (n > 0 && ranges_[i].first <= ranges_[n - 1].second + 1) {
+            ranges_[n - 1].second = max(ranges_[n - 1].second, ranges_[i].second);
+        } else {
+            ranges_[n++] = ranges_[i];
+        }
+    }
+    ranges_.resize(n);
+    return true;
+}
+
+// 206响应：单段直接发送文件的一部分，多段按multipart/byteranges拼接，文件内容都不拷贝
+void HttpResponse::AddRangeContent_(ChainBuffer &buff) {
+    size_t size = file_->st.st_size;
+    if (ranges_.size() == 1) {
+        size_t from = ranges_[0].first, to = ranges_[0].second;
+        buff.Append("Content-type: ");
+        buff.Append(file_->mimeType);
+        buff.Append("\r\nContent-Range: bytes ");
+        AppendNum_(buff, from);
+        buff.Append("-");
+        AppendNum_(buff, to);
+        buff.Append("/");
+        AppendNum_(buff, size);
+        buff.Append("\r\nETag: ");
+        buff.Append(file_->etag);
+        buff.Append("\r\nLast-Modified: ");
+        buff.Append(file_->lastModified);
+        buff.Append("\r\nContent-length: ");
+        AppendNum_(buff, to - from + 1);
+        buff.Append("\r\n\r\n");
+        MarkBuff_(buff);
+        MarkFile_(from, to - from + 1);
+        return;
+    }
+
+    static atomic<uint64_t> boundarySeq(time(nullptr));
+    char boundary[24];
+    snprintf(boundary, sizeof(boundary), "%020llu", static_cast<unsigned long long>(boundarySeq++));
+    vector<string> parts;
+    size_t total = 0;
+    for (const auto &range: ranges_) {
+        parts.push_back(string("\r\n--") + boundary + "\r\nContent-type: " + file_->mimeType + "\r\n" +
+                        "Content-Range: bytes " + to_string(range.first) + "-" + to_string(range.second) +
+                        "/" + to_string(size) + "\r\n\r\n");
+        total += parts.back().size() + range.second - range.first + 1;
+    }
+    string tail = string("\r\n--") + boundary + "--\r\n";
+    total += tail.size();
+
+    buff.Append(string("Content-type: multipart/byteranges; boundary=") + boundary + "\r\n");
+    buff.Append("ETag: " + file_->etag + "\r\nLast-Modified: " + file_->lastModified + "\r\n");
+    buff.Append("Content-length: ");
+    AppendNum_(buff, total);
+    buff.Append("\r\n\r\n");
+    for (size_t i = 0; i < ranges_.size(); i++) {
+        buff.Append(parts[i]);
+        MarkBuff_(buff);
+        MarkFile_(ranges_[i].first, ranges_[i].second - ranges_[i].first + 1);
+    }
+    buff.Append(tail);
+    MarkBuff_(buff);
+}
+
+// 把写缓冲区中新写入的内容记为一段
+void HttpResponse::MarkBuff_(const ChainBuffer &buff) {
+    size_t end = buff.ReadableBytes() - start_;
+    if (end > mark_) {
+        segments_.push_back({true, mark_, end - mark_});
+        mark_ = end;
+    }
+}
+
+void HttpResponse::MarkFile_(size_t offset, size_t len) {
+    if (len > 0) {
+        segments_.push_back({false, offset, len});
+    }
+}
+
+// 释放对文件的引用，缓存项被淘汰后最后一个引用释放时才真正munmap/close
+void HttpResponse::UnmapFile() {
+    file_.reset();
 }
 
 // 获取文件类型
-string HttpResponse::GetFileType_() {
-    /* 判断文件类型 */
-    string::size_type idx = path_.find_last_of('.');
-    if (idx == string::npos) {
-        return "text/plain";
+string_view HttpResponse::GetFileType(string_view path) {
+    return HttpTables::MimeOf(path);
+}
+
+bool HttpResponse::IsCompressible(string_view path) {
+    /* 未知后缀虽然按text/plain发送，但不一定是文本 */
+    const HttpTables::MimeType *mime = HttpTables::FindMime(HttpTables::Suffix(path));
+    return mime && mime->compressible;
+}
+
+bool HttpResponse::IsEncodedVariant(string_view path) {
+    if (path.size() <= 3) { return false; }
+    string_view suffix = path.substr(path.size() - 3);
+    if (suffix != ".gz" && suffix != ".br") { return false; }
+    return IsCompressible(path.substr(0, path.size() - 3));
+}
+
+string HttpResponse::MakeETag(const struct stat &st, const string &encoding) {
+    char buff[96];
+    snprintf(buff, sizeof(buff), "\"%lx-%llx-%llx%s%s\"", static_cast<unsigned long>(st.st_ino),
+             static_cast<unsigned long long>(st.st_size),
+             static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1000000000ULL + st.st_mtim.tv_nsec,
+             encoding.empty() ? "" : "-", encoding.data());
+    return buff;
+}
+
+string HttpResponse::HttpDate(time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buff[64];
+    strftime(buff, sizeof(buff), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return buff;
+}
+
+void HttpResponse::FillEntry(FileEntry &entry, const string &path) {
+    if (IsEncodedVariant(path)) {
+        /* 预压缩变体按原文件的类型发送，由客户端解码 */
+        entry.mimeType = GetFileType(path.substr(0, path.size() - 3));
+        entry.encoding = path.compare(path.size() - 3, 3, ".br") == 0 ? "br" : "gzip";
+    } else {
+        entry.mimeType = GetFileType(path);
+    }
+    entry.headers = "Content-type: " + entry.mimeType + "\r\n";
+    if (!entry.encoding.empty()) {
+        entry.headers += "Content-Encoding: " + entry.encoding + "\r\n";
+    }
+    if (!entry.encoding.empty() || IsCompressible(path)) {
+        /* 同一个URL的响应随Accept-Encoding变化，告诉缓存按它区分 */
+        entry.headers += "Vary: Accept-Encoding\r\n";
     }
-    string suffix = path_.substr(idx);
-    if (SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
+    if (entry.encoding.empty()) {
+        entry.headers += "Accept-Ranges: bytes\r\n";
     }
-    return "text/plain";
+    entry.etag = MakeETag(entry.st, entry.encoding);
+    entry.lastModified = HttpDate(entry.st.st_mtime);
+    entry.headers += "ETag: " + entry.etag + "\r\n";
+    entry.headers += "Last-Modified: " + entry.lastModified + "\r\n";
+    entry.headers += "Content-length: " + to_string(entry.st.st_size) + "\r\n\r\n";
 }
 
-// 错误页面内容
-void HttpResponse::ErrorContent(Buffer &buff, string message) {
+// 生成的错误页面
+string HttpResponse::ErrorBody_(int code, const string &message) {
     string body;
-    string status;
+    int index = HttpTables::StatusOf(code);
+    string_view status = index >= 0 ? HttpTables::STATUSES[index].text : "Bad Request";
     body += "<html><title>Error</title>";
     body += "<body bgcolor=\"ffffff\">";
-    if (CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    } else {
-        status = "Bad Request";
-    }
-    body += to_string(code_) + " : " + status + "\n";
+    body += to_string(code) + " : " + string(status) + "\n";
     body += "<p>" + message + "</p>";
     body += "<hr><em>TinyWebServer</em></body></html>";
+    return body;
+}
 
-    buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
+// 错误页面内容
+void HttpResponse::ErrorContent(ChainBuffer &buff, string message) {
+    string body = ErrorBody_(code_, message);
+    if (allowChunked_ && (acceptEncoding_ & FileEntry::GZIP) && Deflater::Worth(body.size()) &&
+        Deflater::Local()->IsValid()) {
+        /* 动态生成的内容边压缩边按chunked编码输出，不需要预先知道压缩后的长度；
+         * 先压缩到单独的块链，成功后才写响应头并直接接过压缩结果的块，失败时退回Content-length */
+        ChainBuffer chunks;
+        if (Deflater::Local()->GzipChunked(body.data(), body.size(), chunks)) {
+            buff.Append("Content-Encoding: gzip\r\nVary: Accept-Encoding\r\nTransfer-Encoding: chunked\r\n\r\n");
+            buff.Append(std::move(chunks));
+            return;
+        }
+    }
+    buff.Append("Content-length: ");
+    AppendNum_(buff, body.size());
+    buff.Append("\r\n\r\n");
     buff.Append(body);
 }
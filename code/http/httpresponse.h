@@ -6,58 +6,159 @@
 #ifndef HTTP_RESPONSE_H
 #define HTTP_RESPONSE_H
 
-#include <unordered_map>
+#include <vector>
+#include <algorithm>     // sort
+#include <atomic>
+#include <time.h>
+#include <string_view>
+#include <strings.h>     // strncasecmp
 #include <fcntl.h>       // open
 #include <unistd.h>      // close
 #include <sys/stat.h>    // stat
 #include <sys/mman.h>    // mmap, munmap
 
 #include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 #include "../log/log.h"
+#include "filecache.h"
+#include "httptables.h"
 
 class HttpResponse {
 public:
+    // 响应中的一段待发送数据：写缓冲区中的响应头、分段头，或者文件的一部分
+    struct Segment {
+        bool inBuff;    // true时offset相对本响应在写缓冲区中的起点，false时为文件内的偏移
+        size_t offset;
+        size_t len;
+    };
+
     HttpResponse();
 
     ~HttpResponse();
 
     void Init(const std::string &srcDir, std::string &path, bool isKeepAlive = false, int code = -1);
 
-    void MakeResponse(Buffer &buff);
+    // 根据请求的Accept-Encoding决定可以使用哪些压缩编码，HTTP/1.0的客户端不支持chunked
+    void SetAcceptEncoding(std::string_view acceptEncoding, bool allowChunked = true);
+
+    // 请求的Range头，只对200的文件响应生效；If-Range与当前的ETag或Last-Modified不符时忽略Range
+    void SetRange(std::string_view range, std::string_view ifRange = std::string_view());
+
+    // 条件请求的If-None-Match、If-Modified-Since头，满足时返回304
+    void SetConditional(std::string_view ifNoneMatch, std::string_view ifModifiedSince);
+
+    void MakeResponse(ChainBuffer &buff);
 
+    // MakeResponse生成的待发送数据，按顺序发送
+    const std::vector<Segment> &Segments() const { return segments_; }
+
+    // 本响应在写缓冲区中的起点
+    size_t BuffStart() const { return start_; }
+
+    // 释放对文件缓存项的引用
     void UnmapFile();
 
     char *File();
 
+    // 大文件不做映射，由HttpConn直接sendfile这个描述符
+    int FileFd() const { return file_ ? file_->fd : -1; }
+
     size_t FileLen() const;
 
-    void ErrorContent(Buffer &buff, std::string message);
+    void ErrorContent(ChainBuffer &buff, std::string message);
 
     int Code() const { return code_; }
 
+    // 根据文件后缀获取MIME类型
+    static std::string_view GetFileType(std::string_view path);
+
+    // 后缀对应文本类MIME类型的文件才值得压缩
+    static bool IsCompressible(std::string_view path);
+
+    // a.css.gz、a.css.br这样由可压缩文件生成的预压缩变体
+    static bool IsEncodedVariant(std::string_view path);
+
+    // 由文件的inode、大小、修改时间和内容编码生成强ETag
+    static std::string MakeETag(const struct stat &st, const std::string &encoding);
+
+    // RFC 7231的HTTP-date格式
+    static std::string HttpDate(time_t t);
+
+    // 根据路径和stat填写缓存项的MIME类型、编码、校验值并生成实体头
+    static void FillEntry(FileEntry &entry, const std::string &path);
+
+    // 把错误页面读入内存并生成gzip版本，之后错误响应不再访问文件系统；重新加载资源时再次调用
+    static void LoadErrorPages(const std::string &srcDir);
+
+    // 刷新缓存的Date头，由事件循环每次醒来时调用，同一秒内只格式化一次
+    static void UpdateDate();
+
+    static size_t sendfileThreshold;    // 文件大小达到该值时使用sendfile发送，0表示总是使用mmap
+
 private:
-    void AddStateLine_(Buffer &buff);
+    void AddStateLine_(ChainBuffer &buff);
+
+    void AddHeader_(ChainBuffer &buff);
+
+    struct HeadTemplate {
+        std::string head[2];  // 下标为是否保持连接
+    };
+
+    static const HeadTemplate *HeadTemplates_();
+
+    static void AppendNum_(ChainBuffer &buff, size_t value);
+
+    void AddContent_(ChainBuffer &buff);
+
+    bool ErrorHtml_();
+
+    static std::string ErrorBody_(int code, const std::string &message);
 
-    void AddHeader_(Buffer &buff);
+    void Negotiate_();
 
-    void AddContent_(Buffer &buff);
+    bool NotModified_(ChainBuffer &buff);
 
-    void ErrorHtml_();
+    bool EtagMatch_(const std::string &etag) const;
 
-    std::string GetFileType_();
+    void AddNotModified_(ChainBuffer &buff, const std::string &etag, const std::string &lastModified, bool vary);
+
+    bool Range_();
+
+    bool ParseRange_(size_t size);
+
+    void AddRangeContent_(ChainBuffer &buff);
+
+    void MarkBuff_(const ChainBuffer &buff);
+
+    void MarkFile_(size_t offset, size_t len);
+
+    static const size_t MAX_RANGES = 16;  // 超过这么多段时忽略Range，发送整个文件
 
     int code_;
     bool isKeepAlive_;
+    int acceptEncoding_;  // 客户端接受的FileEntry::Encoding组合
+    bool allowChunked_;
+
+    std::string range_;
+    std::string ifRange_;
+    std::string ifNoneMatch_;
+    std::string ifModifiedSince_;
+    std::vector<std::pair<size_t, size_t>> ranges_;  // 合并后的[first, last]，按位置排序
+    std::vector<Segment> segments_;
+    size_t start_;
+    size_t mark_;   // 写缓冲区中已经记入segments_的位置
 
     std::string path_;
     std::string srcDir_;
 
-    char *mmFile_;
-    struct stat mmFileStat_;
+    std::shared_ptr<const FileEntry> file_;   // 文件缓存项，发送完之前一直持有
+
+    static std::shared_ptr<const FileEntry> errorPages_[HttpTables::STATUS_NUM][2];  // 用atomic_load访问，下标1为gzip版本
 
-    static const std::unordered_map <std::string, std::string> SUFFIX_TYPE;  // 后缀类型
-    static const std::unordered_map<int, std::string> CODE_STATUS;  // 状态码对应状态码
-    static const std::unordered_map<int, std::string> CODE_PATH;    // 状态码对应路径
+    static const size_t DATE_LEN = 37;  // "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+    static char date_[2][DATE_LEN + 1];
+    static std::atomic<int> dateIdx_;
+    static std::atomic<time_t> dateSec_;
 };
 
 
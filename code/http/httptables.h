@@ -0,0 +1,228 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-29
+ * @copyleft Apache 2.0
+ */
+#ifndef HTTP_TABLES_H
+#define HTTP_TABLES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+/* 编译期生成的MIME类型和状态码表
+ * 后缀表用完美哈希：编译期搜索一个种子，使所有后缀的哈希值落在不同的槽中，
+ * 查找时一次哈希、一次比较，不分配内存；状态码直接以数值为下标 */
+namespace HttpTables {
+
+struct MimeType {
+    std::string_view suffix;
+    std::string_view type;
+    bool compressible;  // 文本类内容，值得gzip/br压缩
+};
+
+constexpr MimeType MIME_TYPES[] = {
+        /* 文本 */
+        {".html",        "text/html",                      true},
+        {".htm",         "text/html",                      true},
+        {".css",         "text/css",                       true},
+        {".js",          "text/javascript",                true},
+        {".mjs",         "text/javascript",                true},
+        {".txt",         "text/plain",                     true},
+        {".csv",         "text/csv",                       true},
+        {".md",          "text/markdown",                  true},
+        {".xml",         "text/xml",                       true},
+        {".xhtml",       "application/xhtml+xml",          true},
+        {".json",        "application/json",               true},
+        {".map",         "application/json",               true},
+        {".jsonld",      "application/ld+json",            true},
+        {".webmanifest", "application/manifest+json",      true},
+        {".rss",         "application/rss+xml",            true},
+        {".atom",        "application/atom+xml",           true},
+        {".rtf",         "application/rtf",                true},
+        {".wasm",        "application/wasm",               true},
+        {".svg",         "image/svg+xml",                  true},
+        /* 图片 */
+        {".png",         "image/png",                      false},
+        {".gif",         "image/gif",                      false},
+        {".jpg",         "image/jpeg",                     false},
+        {".jpeg",        "image/jpeg",                     false},
+        {".webp",        "image/webp",                     false},
+        {".avif",        "image/avif",                     false},
+        {".bmp",         "image/bmp",                      true},
+        {".ico",         "image/x-icon",                   true},
+        {".tif",         "image/tiff",                     false},
+        {".tiff",        "image/tiff",                     false},
+        /* 字体 */
+        {".woff",        "font/woff",                      false},
+        {".woff2",       "font/woff2",                     false},
+        {".ttf",         "font/ttf",                       true},
+        {".otf",         "font/otf",                       true},
+        {".eot",         "application/vnd.ms-fontobject",  true},
+        /* 音视频 */
+        {".au",          "audio/basic",                    false},
+        {".mp3",         "audio/mpeg",                     false},
+        {".ogg",         "audio/ogg",                      false},
+        {".wav",         "audio/wav",                      false},
+        {".flac",        "audio/flac",                     false},
+        {".aac",         "audio/aac",                      false},
+        {".m4a",         "audio/mp4",                      false},
+        {".mp4",         "video/mp4",                      false},
+        {".m4v",         "video/mp4",                      false},
+        {".webm",        "video/webm",                     false},
+        {".ogv",         "video/ogg",                      false},
+        {".mpeg",        "video/mpeg",                     false},
+        {".mpg",         "video/mpeg",                     false},
+        {".avi",         "video/x-msvideo",                false},
+        {".mov",         "video/quicktime",                false},
+        {".m3u8",        "application/vnd.apple.mpegurl",  true},
+        /* 文档与压缩包 */
+        {".pdf",         "application/pdf",                false},
+        {".doc",         "application/msword",             false},
+        {".word",        "application/msword",             false},
+        {".docx",        "application/vnd.openxmlformats-officedocument.wordprocessingml.document", false},
+        {".xls",         "application/vnd.ms-excel",       false},
+        {".xlsx",        "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet", false},
+        {".ppt",         "application/vnd.ms-powerpoint",  false},
+        {".pptx",        "application/vnd.openxmlformats-officedocument.presentationml.presentation", false},
+        {".gz",          "application/gzip",               false},
+        {".br",          "application/x-brotli",           false},
+        {".zip",         "application/zip",                false},
+        {".tar",         "application/x-tar",              false},
+        {".7z",          "application/x-7z-compressed",    false},
+        {".bin",         "application/octet-stream",       false},
+        /* .ts既可能是TypeScript源码也可能是MPEG-TS分片，按video/mp2t返回时浏览器会拒绝加载脚本 */
+        {".ts",          "application/octet-stream",       false},
+};
+
+constexpr size_t MIME_NUM = sizeof(MIME_TYPES) / sizeof(MIME_TYPES[0]);
+
+// 带种子的FNV-1a
+constexpr uint32_t Hash(uint32_t seed, std::string_view str) {
+    uint32_t h = 2166136261u ^ seed;
+    for (char ch: str) {
+        h = (h ^ static_cast<uint8_t>(ch)) * 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+// 槽数取不小于后缀数8倍的2的幂，冲突少，能很快找到种子
+constexpr size_t SlotNum() {
+    size_t n = 1;
+    while (n < MIME_NUM * 8) { n <<= 1; }
+    return n;
+}
+
+constexpr size_t SLOT_NUM = SlotNum();
+constexpr uint8_t EMPTY_SLOT = 0xff;
+static_assert(MIME_NUM < EMPTY_SLOT, "too many mime types");
+
+struct MimeIndex {
+    uint32_t seed;
+    uint8_t slots[SLOT_NUM];
+};
+
+// 编译期搜索没有冲突的种子，并填好槽位
+constexpr MimeIndex BuildMimeIndex() {
+    MimeIndex index{};
+    for (uint32_t seed = 1; seed < 100000; seed++) {
+        for (size_t i = 0; i < SLOT_NUM; i++) {
+            index.slots[i] = EMPTY_SLOT;
+        }
+        bool ok = true;
+        for (size_t i = 0; i < MIME_NUM && ok; i++) {
+            size_t slot = Hash(seed, MIME_TYPES[i].suffix) & (SLOT_NUM - 1);
+            if (index.slots[slot] != EMPTY_SLOT) {
+                ok = false;
+            } else {
+                index.slots[slot] = static_cast<uint8_t>(i);
+            }
+        }
+        if (ok) {
+            index.seed = seed;
+            return index;
+        }
+    }
+    index.seed = 0;
+    return index;
+}
+
+constexpr MimeIndex MIME_INDEX = BuildMimeIndex();
+static_assert(MIME_INDEX.seed != 0, "no perfect hash seed for mime types");
+
+// 按后缀(含点，如".css")查找，没有时返回nullptr
+constexpr const MimeType *FindMime(std::string_view suffix) {
+    uint8_t i = MIME_INDEX.slots[Hash(MIME_INDEX.seed, suffix) & (SLOT_NUM - 1)];
+    if (i == EMPTY_SLOT || MIME_TYPES[i].suffix != suffix) {
+        return nullptr;
+    }
+    return &MIME_TYPES[i];
+}
+
+// 路径的后缀，没有时为空
+constexpr std::string_view Suffix(std::string_view path) {
+    size_t idx = path.find_last_of("./");
+    if (idx == std::string_view::npos || path[idx] != '.') {
+        return std::string_view();
+    }
+    return path.substr(idx);
+}
+
+constexpr std::string_view DEFAULT_MIME = "text/plain";
+
+// 根据路径获取MIME类型，未知后缀按text/plain处理
+constexpr std::string_view MimeOf(std::string_view path) {
+    const MimeType *mime = FindMime(Suffix(path));
+    return mime ? mime->type : DEFAULT_MIME;
+}
+
+struct Status {
+    int code;
+    std::string_view text;
+    std::string_view page;  // 错误页面，相对资源目录
+};
+
+constexpr Status STATUSES[] = {
+        {200, "OK",                    ""},
+        {206, "Partial Content",       ""},
+        {304, "Not Modified",          ""},
+        {400, "Bad Request",           "/400.html"},
+        {403, "Forbidden",             "/403.html"},
+        {404, "Not Found",             "/404.html"},
+        {416, "Range Not Satisfiable", ""},
+};
+
+constexpr size_t STATUS_NUM = sizeof(STATUSES) / sizeof(STATUSES[0]);
+constexpr int MIN_CODE = 100;
+constexpr int MAX_CODE = 599;
+
+// 状态码 -> STATUSES下标，-1表示不支持
+struct StatusIndex {
+    int8_t index[MAX_CODE - MIN_CODE + 1];
+};
+
+constexpr StatusIndex BuildStatusIndex() {
+    StatusIndex res{};
+    for (int i = 0; i <= MAX_CODE - MIN_CODE; i++) {
+        res.index[i] = -1;
+    }
+    for (size_t i = 0; i < STATUS_NUM; i++) {
+        res.index[STATUSES[i].code - MIN_CODE] = static_cast<int8_t>(i);
+    }
+    return res;
+}
+
+constexpr StatusIndex STATUS_INDEX = BuildStatusIndex();
+
+// 状态码在STATUSES中的下标，不支持的返回-1
+constexpr int StatusOf(int code) {
+    return code < MIN_CODE || code > MAX_CODE ? -1 : STATUS_INDEX.index[code - MIN_CODE];
+}
+
+static_assert(MimeOf("/css/a.css") == "text/css", "mime table");
+static_assert(MimeOf("/a.b/README") == DEFAULT_MIME, "mime table");
+static_assert(StatusOf(404) >= 0 && STATUSES[StatusOf(404)].page == "/404.html", "status table");
+
+} // namespace HttpTables
+
+#endif //HTTP_TABLES_H
@@ -0,0 +1,126 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-28
+ * @copyleft Apache 2.0
+ */
+#include "precompress.h"
+#include "httpresponse.h"
+
+using namespace std;
+
+int Precompressor::Run(const string &srcDir, size_t minSize) {
+    string dir = srcDir;
+    while (!dir.empty() && dir.back() == '/') {
+        dir.pop_back();
+    }
+    int count = Walk_(dir, minSize);
+    LOG_INFO("precompress %s: %d files generated", dir.data(), count);
+    return count;
+}
+
+int Precompressor::Walk_(const string &dir, size_t minSize) {
+    DIR *dp = opendir(dir.data());
+    if (!dp) { return 0; }
+    int count = 0;
+    while (struct dirent *ent = readdir(dp)) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) { continue; }
+        string file = dir + "/" + ent->d_name;
+        struct stat st;
+        if (stat(file.data(), &st) < 0) { continue; }
+        if (S_ISDIR(st.st_mode)) {
+            count += Walk_(file, minSize);
+            continue;
+        }
+        if (!S_ISREG(st.st_mode) || static_cast<size_t>(st.st_size) < minSize ||
+            !HttpResponse::IsCompressible(file)) {
+            continue;
+        }
+        /* 压缩文件本身(a.css.gz)的后缀是.gz/.br，不会进入这里 */
+        for (const char *suffix: {".gz", ".br"}) {
+            struct stat zst;
+            if (stat((file + suffix).data(), &zst) == 0 && zst.st_mtime >= st.st_mtime) {
+                continue;
+            }
+            if (Compress_(file, st, suffix)) {
+                count++;
+            }
+        }
+    }
+    closedir(dp);
+    return count;
+}
+
+bool Precompressor::Compress_(const string &file, const struct stat &st, const string &suffix) {
+    string src(st.st_size, '\0');
+    int fd = open(file.data(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return false; }
+    size_t done = 0;
+    while (done < src.size()) {
+        ssize_t len = read(fd, &src[done], src.size() - done);
+        if (len < 0 && errno == EINTR) { continue; }
+        if (len <= 0) { break; }
+        done += len;
+    }
+    close(fd);
+    if (done != src.size()) { return false; }
+
+    string dst;
+    bool ok = suffix == ".gz" ? Gzip_(src, dst) : Brotli_(src, dst);
+    if (!ok || dst.size() >= src.size()) {
+        /* 压缩后没有变小就不必提供这个变体，删掉过期的旧变体 */
+        unlink((file + suffix).data());
+        return false;
+    }
+
+    string tmp = file + suffix + ".tmp";
+    fd = open(tmp.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 0777);
+    if (fd < 0) {
+        LOG_WARN("precompress create %s error!", tmp.data());
+        return false;
+    }
+    done = 0;
+    while (done < dst.size()) {
+        ssize_t len = write(fd, dst.data() + done, dst.size() - done);
+        if (len < 0 && errno == EINTR) { continue; }
+        if (len <= 0) { break; }
+        done += len;
+    }
+    close(fd);
+    if (done != dst.size() || rename(tmp.data(), (file + suffix).data()) < 0) {
+        unlink(tmp.data());
+        return false;
+    }
+    LOG_DEBUG("precompress %s%s: %zu -> %zu", file.data(), suffix.data(), src.size(), dst.size());
+    return true;
+}
+
+// gzip格式(windowBits加16)，最高压缩级别
+bool Precompressor::Gzip_(const string &src, string &dst) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    dst.resize(deflateBound(&zs, src.size()));
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src.data()));
+    zs.avail_in = src.size();
+    zs.next_out = reinterpret_cast<Bytef *>(&dst[0]);
+    zs.avail_out = dst.size();
+    int ret = deflate(&zs, Z_FINISH);
+    dst.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+
+bool Precompressor::Brotli_(const string &src, string &dst) {
+    size_t len = BrotliEncoderMaxCompressedSize(src.size());
+    if (len == 0) { return false; }
+    dst.resize(len);
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               src.size(), reinterpret_cast<const uint8_t *>(src.data()),
+                               &len, reinterpret_cast<uint8_t *>(&dst[0]))) {
+        return false;
+    }
+    dst.resize(len);
+    return true;
+}
@@ -0,0 +1,40 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-28
+ * @copyleft Apache 2.0
+ */
+#ifndef PRECOMPRESS_H
+#define PRECOMPRESS_H
+
+#include <string>
+#include <fcntl.h>       // open
+#include <unistd.h>      // read, write, close
+#include <dirent.h>      // opendir
+#include <stdio.h>       // rename
+#include <string.h>      // strcmp
+#include <errno.h>
+#include <sys/stat.h>    // stat
+#include <zlib.h>
+#include <brotli/encode.h>
+
+#include "../log/log.h"
+
+/* 静态资源预压缩：为资源目录下可压缩的文本文件生成同目录的.gz和.br文件，
+ * 已存在且不比原文件旧的跳过，压缩后没有变小的不生成。
+ * 先写临时文件再rename，正在运行的服务器通过inotify感知到新文件 */
+class Precompressor {
+public:
+    // 处理srcDir下不小于minSize字节的文件，返回生成的文件数
+    static int Run(const std::string &srcDir, size_t minSize);
+
+private:
+    static int Walk_(const std::string &dir, size_t minSize);
+
+    static bool Compress_(const std::string &file, const struct stat &st, const std::string &suffix);
+
+    static bool Gzip_(const std::string &src, std::string &dst);
+
+    static bool Brotli_(const std::string &src, std::string &dst);
+};
+
+#endif //PRECOMPRESS_H
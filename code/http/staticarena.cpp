@@ -0,0 +1,115 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-28
+ * @copyleft Apache 2.0
+ */
+#include "staticarena.h"
+#include "httpresponse.h"
+
+using namespace std;
+
+StaticArena::StaticArena() : base_(nullptr), size_(0), hugePage_(false) {}
+
+StaticArena::~StaticArena() {
+    if (base_) {
+        munmap(base_, size_);
+    }
+}
+
+shared_ptr<StaticArena> StaticArena::Build(const string &srcDir) {
+    shared_ptr<StaticArena> arena(new StaticArena());
+    size_t total = 0;
+    if (!arena->Scan_(srcDir, "", total) || !arena->Map_(total)) {
+        return nullptr;
+    }
+    for (auto &item: arena->files_) {
+        if (!HttpResponse::IsCompressible(item.first) || !item.second.encoding.empty()) { continue; }
+        if (arena->files_.count(item.first + ".gz")) { item.second.variants |= FileEntry::GZIP; }
+        if (arena->files_.count(item.first + ".br")) { item.second.variants |= FileEntry::BR; }
+    }
+
+    /* 文件内容依次放入预加载区，每个文件按缓存行对齐 */
+    size_t offset = 0;
+    for (auto &item: arena->files_) {
+        FileEntry &entry = item.second;
+        size_t size = entry.st.st_size;
+        if (!entry.Readable() || size == 0) { continue; }
+        int fd = open((srcDir + item.first).data(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { return nullptr; }
+        char *dst = arena->base_ + offset;
+        size_t done = 0;
+        while (done < size) {
+            ssize_t len = read(fd, dst + done, size - done);
+            if (len < 0 && errno == EINTR) { continue; }
+            if (len <= 0) { break; }
+            done += len;
+        }
+        close(fd);
+        if (done != size) {
+            /* 加载过程中文件被修改了 */
+            return nullptr;
+        }
+        entry.data = dst;
+        offset += (size + ALIGN - 1) & ~(ALIGN - 1);
+    }
+    if (arena->base_) {
+        mprotect(arena->base_, arena->size_, PROT_READ);
+    }
+    return arena;
+}
+
+shared_ptr<const FileEntry> StaticArena::Find(const string &path) const {
+    auto it = files_.find(path);
+    if (it == files_.end()) {
+        return nullptr;
+    }
+    return shared_ptr<const FileEntry>(shared_from_this(), &it->second);
+}
+
+// 递归收集目录下的普通文件并生成响应头，total累加需要的内存
+bool StaticArena::Scan_(const string &srcDir, const string &dir, size_t &total) {
+    DIR *dp = opendir((srcDir + dir).data());
+    if (!dp) { return false; }
+    bool ok = true;
+    while (struct dirent *ent = readdir(dp)) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) { continue; }
+        string path = dir + "/" + ent->d_name;
+        struct stat st;
+        if (stat((srcDir + path).data(), &st) < 0) { continue; }
+        if (S_ISDIR(st.st_mode)) {
+            if (!Scan_(srcDir, path, total)) { ok = false; break; }
+            continue;
+        }
+        if (!S_ISREG(st.st_mode)) { continue; }
+        FileEntry &entry = files_[path];
+        entry.st = st;
+        entry.ownsData = false;
+        HttpResponse::FillEntry(entry, path);
+        if (entry.Readable()) {
+            total += (st.st_size + ALIGN - 1) & ~(ALIGN - 1);
+        }
+    }
+    closedir(dp);
+    return ok;
+}
+
+// 申请按大页对齐的匿名内存
+bool StaticArena::Map_(size_t total) {
+    if (total == 0) { return true; }
+    size_ = (total + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    void *mmRet = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mmRet != MAP_FAILED) {
+        hugePage_ = true;
+    } else {
+        /* 没有预留大页时退回普通页，并建议内核使用透明大页 */
+        mmRet = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mmRet == MAP_FAILED) {
+            size_ = 0;
+            return false;
+        }
+        madvise(mmRet, size_, MADV_HUGEPAGE);
+    }
+    base_ = static_cast<char *>(mmRet);
+    return true;
+}
@@ -0,0 +1,62 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-28
+ * @copyleft Apache 2.0
+ */
+#ifndef STATIC_ARENA_H
+#define STATIC_ARENA_H
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <string.h>      // strcmp
+#include <errno.h>
+#include <fcntl.h>       // open
+#include <unistd.h>      // read, close
+#include <dirent.h>      // opendir
+#include <sys/stat.h>    // stat
+#include <sys/mman.h>    // mmap, madvise
+
+#include "fileentry.h"
+
+/* 静态资源预加载区：启动时把整个资源目录读进一块连续的匿名内存，
+ * 尽量使用大页(先尝试MAP_HUGETLB，失败后用透明大页)减少TLB缺失，
+ * 每个文件的响应头在加载时生成，请求路径上只有一次哈希查找，不再有stat/open/mmap。
+ * 加载完成后整块内存只读；重新加载时生成新的预加载区整体替换，旧的在最后一个响应发送完后释放 */
+class StaticArena : public std::enable_shared_from_this<StaticArena> {
+public:
+    // 读入srcDir下的全部文件，出错时返回nullptr
+    static std::shared_ptr<StaticArena> Build(const std::string &srcDir);
+
+    ~StaticArena();
+
+    StaticArena(const StaticArena &) = delete;
+
+    StaticArena &operator=(const StaticArena &) = delete;
+
+    // path为相对srcDir的路径，不存在时返回nullptr；返回的缓存项共享整个预加载区的所有权
+    std::shared_ptr<const FileEntry> Find(const std::string &path) const;
+
+    size_t FileCount() const { return files_.size(); }
+
+    size_t Bytes() const { return size_; }
+
+    bool HugePage() const { return hugePage_; }
+
+private:
+    StaticArena();
+
+    static const size_t HUGE_PAGE_SIZE = 2 << 20;
+    static const size_t ALIGN = 64;
+
+    bool Scan_(const std::string &srcDir, const std::string &dir, size_t &total);
+
+    bool Map_(size_t total);
+
+    std::unordered_map<std::string, FileEntry> files_;  // 相对路径 -> 文件
+    char *base_;
+    size_t size_;
+    bool hugePage_;
+};
+
+#endif //STATIC_ARENA_H
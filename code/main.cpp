@@ -10,10 +10,30 @@ int main() {
     /* 守护进程 后台运行 */
     //daemon(1, 0); 
 
+    Config config;
+    config.reactorNum = 0;                 /* one loop per thread的Reactor数量，0为主线程epoll+线程池 */
+    config.workStealing = false;           /* 线程池使用工作窃取 */
+    config.taskQueueSize = 4096;           /* 线程池任务队列容量 */
+    config.rejectOverload = false;         /* 队列满时回复503，否则推迟处理 */
+    config.dbThreadNum = 0;                /* 处理数据库请求的慢速通道线程数 */
+    config.threadMaxNum = 0;               /* 线程池最多伸缩到的线程数，0为固定 */
+    config.metricsIntervalMS = 0;          /* 输出运行统计的间隔，0为不输出 */
+    config.ioUring = false;                /* 使用io_uring作为事件后端 */
+    config.timeWheel = false;              /* 使用时间轮代替小根堆定时器 */
+    config.sendfileThreshold = 64 * 1024;  /* 达到该大小的文件用sendfile发送 */
+    config.releaseIdleBuffer = false;      /* 空闲长连接释放缓冲区内存 */
+    config.fileCacheSize = 64 << 20;       /* 静态文件缓存字节数 */
+    config.fileCacheFds = 256;             /* 静态文件缓存中保持打开的描述符数 */
+    config.preload = false;                /* 预加载资源目录，kill -HUP重新加载 */
+    config.precompress = false;            /* 生成并发送.gz/.br预压缩变体 */
+    config.gzip = false;                   /* 即时gzip压缩 */
+    config.gzipLevel = 6;                  /* 即时压缩级别 */
+
     WebServer server(
         1316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
         3306, "root", "root", "webserver", /* Mysql配置 */
-        12, 6, true, 1, 1024);             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+        12, 6, true, 1, 1024,              /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+        config);
     server.Start();
 } 
   
\ No newline at end of file
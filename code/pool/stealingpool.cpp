@@ -0,0 +1,152 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-15
+ * @copyleft Apache 2.0
+ */
+#include "stealingpool.h"
+
+using namespace std;
+
+// 当前线程所属的线程池和它在池中的下标，外部线程为nullptr
+static thread_local StealingPool *localPool = nullptr;
+static thread_local size_t localIndex = 0;
+
+StealingPool::StealingPool(size_t threadCount, size_t queueSize) :
+        injection_(queueSize), freeTasks_(queueSize), isClosed_(false), sleepers_(0), epoch_(0) {
+    assert(threadCount > 0);
+    for (size_t i = 0; i < threadCount; i++) {
+        workers_.emplace_back(new Worker());
+    }
+    /* 所有队列建好之后才启动线程，窃取时可以安全地遍历workers_ */
+    for (size_t i = 0; i < threadCount; i++) {
+        workers_[i]->thread = thread(&StealingPool::Run_, this, i);
+    }
+}
+
+StealingPool::~StealingPool() {
+    isClosed_ = true;
+    Wake_(true);
+    for (auto &worker: workers_) {
+        worker->thread.join();
+    }
+    Task *task;
+    while (freeTasks_.TryPop(task)) {
+        delete task;
+    }
+}
+
+Task *StealingPool::NewTask_() {
+    Task *task;
+    if (freeTasks_.TryPop(task)) { return task; }
+    return new Task();
+}
+
+void StealingPool::FreeTask_(Task *task) {
+    task->Reset();
+    if (!freeTasks_.TryPush(move(task))) {
+        delete task;
+    }
+}
+
+void StealingPool::Push_(Task *task) {
+    while (!TryPush_(task)) {
+        this_thread::yield();
+    }
+}
+
+bool StealingPool::TryPush_(Task *task) {
+    if (localPool == this) {
+        workers_[localIndex]->deque.Push(task);
+    } else if (!injection_.TryPush(move(task))) {
+        return false;
+    }
+    /* 与Run_中休眠前的检查配对：要么这里看到有线程准备休眠，要么那个线程看到这个任务 */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (sleepers_.load(memory_order_relaxed) > 0) {
+        Wake_(false);
+    }
+    return true;
+}
+
+void StealingPool::Wake_(bool all) {
+    {
+        lock_guard<mutex> locker(mtx_);
+        epoch_++;
+    }
+    if (all) {
+        cond_.notify_all();
+    } else {
+        cond_.notify_one();
+    }
+}
+
+void StealingPool::Run_(size_t index) {
+    localPool = this;
+    localIndex = index;
+    int idle = 0;
+    while (true) {
+        Task *task = Take_(index);
+        if (task) {
+            (*task)();
+            FreeTask_(task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < SPIN_ROUNDS) {
+            this_thread::yield();
+            continue;
+        }
+        /* 先登记为休眠，再检查一遍所有队列，避免错过刚提交的任务 */
+        uint64_t epoch;
+        {
+            lock_guard<mutex> locker(mtx_);
+            epoch = epoch_;
+        }
+        sleepers_.fetch_add(1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (HasWork_()) {
+            sleepers_--;
+            idle = 0;
+            continue;
+        }
+        if (isClosed_) {
+            sleepers_--;
+            break;
+        }
+        {
+            unique_lock<mutex> locker(mtx_);
+            cond_.wait(locker, [&] { return epoch_ != epoch || isClosed_; });
+        }
+        sleepers_--;
+        idle = 0;
+    }
+    localPool = nullptr;
+}
+
+Task *StealingPool::Take_(size_t index) {
+    Task *task = workers_[index]->deque.Pop();
+    if (task) { return task; }
+    if (injection_.TryPop(task)) { return task; }
+    /* 从随机位置开始轮流窃取，避免所有空闲线程都去抢同一个队列 */
+    static thread_local uint32_t seed = static_cast<uint32_t>(index) * 2654435761u + 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    size_t n = workers_.size();
+    size_t start = seed % n;
+    for (size_t k = 0; k < n; k++) {
+        size_t victim = (start + k) % n;
+        if (victim == index) { continue; }
+        task = workers_[victim]->deque.Steal();
+        if (task) { return task; }
+    }
+    return nullptr;
+}
+
+bool StealingPool::HasWork_() const {
+    if (injection_.Size() > 0) { return true; }
+    for (auto &worker: workers_) {
+        if (!worker->deque.Empty()) { return true; }
+    }
+    return false;
+}
@@ -0,0 +1,96 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-15
+ * @copyleft Apache 2.0
+ */
+#ifndef STEALING_POOL_H
+#define STEALING_POOL_H
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <assert.h>
+
+#include "mpmcqueue.h"
+#include "workdeque.h"
+#include "task.h"
+
+/* 工作窃取线程池
+ * 每个工作线程有自己的Chase-Lev双端队列，工作线程提交的任务压入自己的队列；
+ * 事件循环等外部线程提交的任务进入无锁的全局注入队列。
+ * 空闲线程依次尝试：自己的队列 -> 注入队列 -> 随机窃取其他线程，
+ * 都没有任务时先自旋让出CPU，一段时间后才在条件变量上休眠，提交任务时只在有线程休眠时才加锁唤醒。
+ * 队列中存放的是任务节点的指针，节点执行完放回空闲队列复用，稳定后提交任务不分配内存 */
+class StealingPool {
+public:
+    explicit StealingPool(size_t threadCount = 8, size_t queueSize = 4096);
+
+    // 执行完剩余的任务后回收所有线程
+    ~StealingPool();
+
+    StealingPool(const StealingPool &) = delete;
+
+    StealingPool &operator=(const StealingPool &) = delete;
+
+    // 增加一个任务
+    template<class F>
+    void AddTask(F &&task) {
+        Task *node = NewTask_();
+        *node = Task(std::forward<F>(task));
+        Push_(node);
+    }
+
+    // 尝试增加一个任务，注入队列满时返回false；工作线程提交的任务总是成功
+    template<class F>
+    bool TryAddTask(F &&task) {
+        Task *node = NewTask_();
+        *node = Task(std::forward<F>(task));
+        if (!TryPush_(node)) {
+            FreeTask_(node);
+            return false;
+        }
+        return true;
+    }
+
+    // 注入队列中等待执行的任务数(近似值)
+    size_t QueueSize() const { return injection_.Size(); }
+
+private:
+    Task *NewTask_();
+
+    void FreeTask_(Task *task);
+
+    struct Worker {
+        WorkDeque<Task *> deque;
+        std::thread thread;
+    };
+
+    void Push_(Task *task);
+
+    bool TryPush_(Task *task);
+
+    void Run_(size_t index);
+
+    Task *Take_(size_t index);
+
+    bool HasWork_() const;
+
+    void Wake_(bool all);
+
+    static const int SPIN_ROUNDS = 64;        // 休眠前空转的轮数
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    MpmcQueue<Task *> injection_;  // 满时AddTask让出CPU等待，TryAddTask返回false
+    MpmcQueue<Task *> freeTasks_;  // 执行完的任务节点
+    std::atomic<bool> isClosed_;
+    std::atomic<int> sleepers_;  // 准备休眠或正在休眠的线程数
+
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    uint64_t epoch_;  // 每次唤醒加一，休眠线程据此判断是否被唤醒过
+};
+
+#endif //STEALING_POOL_H
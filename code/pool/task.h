@@ -0,0 +1,120 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-15
+ * @copyleft Apache 2.0
+ */
+#ifndef TASK_H
+#define TASK_H
+
+#include <cstddef>     // max_align_t
+#include <new>
+#include <utility>
+#include <type_traits>
+
+/* 只能移动的任务对象，代替std::function<void()>
+ * 可调用对象不超过INLINE_SIZE时直接放在对象内部，不分配内存；
+ * 服务器的读写回调(成员函数指针加this、reactor、连接三个指针，或捕获这三个指针的lambda)都能放下。
+ * 不要求可调用对象可拷贝，超出内联空间的才在堆上分配 */
+class Task {
+public:
+    static const size_t INLINE_SIZE = sizeof(void (Task::*)()) + 3 * sizeof(void *);
+
+    // 可调用对象F能否放进内联空间
+    template<class F>
+    struct IsInline : std::integral_constant<bool,
+            sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible<F>::value> {
+    };
+
+    Task() noexcept: ops_(nullptr) {}
+
+    template<class F, class = typename std::enable_if<
+            !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F &&func) {
+        typedef typename std::decay<F>::type Func;
+        if constexpr (IsInline<Func>::value) {
+            new(storage_) Func(std::forward<F>(func));
+            ops_ = &InlineOps_<Func>::ops;
+        } else {
+            *reinterpret_cast<Func **>(storage_) = new Func(std::forward<F>(func));
+            ops_ = &HeapOps_<Func>::ops;
+        }
+    }
+
+    Task(Task &&other) noexcept: ops_(other.ops_) {
+        if (ops_) {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            Reset();
+            ops_ = other.ops_;
+            if (ops_) {
+                ops_->move(storage_, other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+
+    Task &operator=(const Task &) = delete;
+
+    ~Task() { Reset(); }
+
+    void operator()() { ops_->invoke(storage_); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    void Reset() {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void *storage);
+        void (*move)(void *dst, void *src);  // 移动到dst并销毁src
+        void (*destroy)(void *storage);
+    };
+
+    template<class F>
+    struct InlineOps_ {
+        static F *Get(void *storage) { return std::launder(reinterpret_cast<F *>(storage)); }
+
+        static void Invoke(void *storage) { (*Get(storage))(); }
+
+        static void Move(void *dst, void *src) {
+            new(dst) F(std::move(*Get(src)));
+            Get(src)->~F();
+        }
+
+        static void Destroy(void *storage) { Get(storage)->~F(); }
+
+        static constexpr Ops ops = {Invoke, Move, Destroy};
+    };
+
+    template<class F>
+    struct HeapOps_ {
+        static F *&Get(void *storage) { return *reinterpret_cast<F **>(storage); }
+
+        static void Invoke(void *storage) { (*Get(storage))(); }
+
+        static void Move(void *dst, void *src) { *reinterpret_cast<F **>(dst) = Get(src); }
+
+        static void Destroy(void *storage) { delete Get(storage); }
+
+        static constexpr Ops ops = {Invoke, Move, Destroy};
+    };
+
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops *ops_;
+};
+
+#endif //TASK_H
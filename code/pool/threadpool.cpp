@@ -0,0 +1,218 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-15
+ * @copyleft Apache 2.0
+ */
+#include "threadpool.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t threadCount, size_t queueSize, size_t slowThreadCount) :
+        ThreadPool(threadCount, queueSize, slowThreadCount, Elastic()) {}
+
+ThreadPool::ThreadPool(size_t threadCount, size_t queueSize, size_t slowThreadCount, const Elastic &elastic) {
+    assert(threadCount > 0);
+    lanes_[FAST] = make_shared<Pool>(threadCount, queueSize, elastic.maxThreads, elastic);
+    if(slowThreadCount > 0) {
+        /* 慢速通道按相同的比例伸缩 */
+        size_t slowMax = elastic.maxThreads * slowThreadCount / threadCount;
+        lanes_[SLOW] = make_shared<Pool>(slowThreadCount, queueSize, slowMax, elastic);
+    } else {
+        lanes_[SLOW] = lanes_[FAST];
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    for(int lane = 0; lane < LANE_NUM; lane++) {
+        if(lanes_[lane] && (lane == FAST || lanes_[lane] != lanes_[FAST])) {
+            lanes_[lane]->Close();
+        }
+    }
+    for(int lane = 0; lane < LANE_NUM; lane++) {
+        if(lanes_[lane] && (lane == FAST || lanes_[lane] != lanes_[FAST])) {
+            lanes_[lane]->Join();
+        }
+    }
+}
+
+ThreadPool::Pool::Pool(size_t threadCount, size_t queueSize, size_t maxThreadCount, const Elastic &elastic) :
+        tasks(queueSize), minThreads(threadCount), maxThreads(max(threadCount, maxThreadCount)),
+        growWaitNs(elastic.growWaitUs * 1000), idleNs(elastic.idleMs * 1000000), lastPopNs(NowNs_()) {
+    for(auto &count: waitHist) {
+        count = 0;
+    }
+    lock_guard<mutex> locker(mtx);
+    for(size_t i = 0; i < threadCount; i++) {
+        Spawn();
+    }
+}
+
+void ThreadPool::Run_(Pool *pool, Worker *worker) {
+    int idle = 0;
+    while(true) {
+        // 如果线程池中的任务不为空，则取出一个任务，然后执行
+        Item item;
+        if(pool->tasks.TryPop(item)) {
+            int64_t start = NowNs_();
+            if(idle > 0) {
+                pool->idlers.fetch_sub(1, memory_order_relaxed);
+            }
+            /* 只在时间明显变化时才写，避免所有线程每个任务都写同一条缓存行 */
+            if(start - pool->lastPopNs.load(memory_order_relaxed) > pool->growWaitNs / 4) {
+                pool->lastPopNs.store(start, memory_order_relaxed);
+            }
+            int64_t wait = start - item.enqueueNs;
+            uint64_t us = wait > 0 ? wait / 1000 : 0;
+            int bucket = us == 0 ? 0 : min(64 - __builtin_clzll(us), HIST_NUM - 1);
+            pool->waitHist[bucket].fetch_add(1, memory_order_relaxed);
+            if(wait > pool->growWaitNs) {
+                pool->Grow(start);
+            }
+            item.task();
+            item.task.Reset();
+            worker->busyNs.fetch_add(NowNs_() - start, memory_order_relaxed);
+            pool->taskCount.fetch_add(1, memory_order_relaxed);
+            idle = 0;
+            continue;
+        }
+        /* 从取不到任务开始算作空闲，自旋和休眠期间都是 */
+        if(idle == 0) {
+            pool->idlers.fetch_add(1, memory_order_relaxed);
+        }
+        if(pool->isClosed) break;
+        else if(++idle < SPIN_ROUNDS) this_thread::yield();
+        else if(!pool->Park()) break;
+        else idle = 1;
+    }
+    pool->idlers.fetch_sub(1, memory_order_relaxed);
+    worker->exited = true;
+}
+
+// 登记休眠后再检查一次队列，和Notify配对，不会错过刚提交的任务
+// 返回false表示线程空闲太久，应当退出
+bool ThreadPool::Pool::Park() {
+    unique_lock<mutex> locker(mtx);
+    sleepers.fetch_add(1);
+    atomic_thread_fence(memory_order_seq_cst);
+    bool timeout = false;
+    if(tasks.Size() == 0 && !isClosed) {
+        if(maxThreads > minThreads) {
+            timeout = cond.wait_for(locker, chrono::nanoseconds(idleNs)) == cv_status::timeout;
+        } else {
+            cond.wait(locker);
+        }
+    }
+    sleepers.fetch_sub(1);
+    if(timeout && tasks.Size() == 0 && !isClosed && threads > minThreads) {
+        threads--;
+        return false;
+    }
+    return true;
+}
+
+// 提交任务后唤醒休眠的线程；所有线程都在执行任务、且已有growWait时间没有取出任务时，
+// 说明它们都阻塞在任务中(如都在等数据库)，等它们取出任务再测排队时间就晚了，直接增加线程
+void ThreadPool::Pool::Notify(int64_t now) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if(sleepers.load(memory_order_relaxed) > 0) {
+        { lock_guard<mutex> locker(mtx); }
+        cond.notify_one();
+    } else if(maxThreads > minThreads && idlers.load(memory_order_relaxed) == 0 &&
+              now - lastPopNs.load(memory_order_relaxed) > growWaitNs) {
+        Grow(now);
+    }
+}
+
+// 任务排队太久，增加一个线程；每个growWait时间段内最多增加一个，避免瞬间的抖动把线程加满
+void ThreadPool::Pool::Grow(int64_t now) {
+    if(maxThreads <= minThreads) { return; }
+    int64_t last = lastGrowNs.load(memory_order_relaxed);
+    if(now - last < growWaitNs || !lastGrowNs.compare_exchange_strong(last, now)) {
+        return;
+    }
+    lock_guard<mutex> locker(mtx);
+    if(isClosed || threads >= maxThreads) { return; }
+    Reap();
+    Spawn();
+}
+
+// 调用者持有mtx
+void ThreadPool::Pool::Spawn() {
+    workers.emplace_back(new Worker());
+    Worker *worker = workers.back().get();
+    worker->lastNs = NowNs_();
+    worker->thread = thread(&ThreadPool::Run_, this, worker);
+    threads++;
+}
+
+// 回收已退出的线程，调用者持有mtx
+void ThreadPool::Pool::Reap() {
+    for(size_t i = 0; i < workers.size();) {
+        if(workers[i]->exited) {
+            workers[i]->thread.join();
+            workers[i] = std::move(workers.back());
+            workers.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+void ThreadPool::Pool::Close() {
+    {
+        lock_guard<mutex> locker(mtx);
+        isClosed = true;
+    }
+    cond.notify_all();
+}
+
+// Close之后不会再有新线程，等所有线程执行完剩余的任务
+void ThreadPool::Pool::Join() {
+    vector<unique_ptr<Worker>> all;
+    {
+        lock_guard<mutex> locker(mtx);
+        all.swap(workers);
+    }
+    for(auto &worker: all) {
+        worker->thread.join();
+    }
+}
+
+ThreadPool::Metrics ThreadPool::GetMetrics(Lane lane) const {
+    Pool &pool = *lanes_[lane];
+    Metrics metrics;
+    metrics.queueDepth = pool.tasks.Size();
+    metrics.tasks = pool.taskCount.load(memory_order_relaxed);
+    for(int i = 0; i < HIST_NUM; i++) {
+        metrics.waitHist[i] = pool.waitHist[i].load(memory_order_relaxed);
+    }
+    int64_t now = NowNs_();
+    lock_guard<mutex> locker(pool.mtx);
+    metrics.threads = pool.threads;
+    for(auto &worker: pool.workers) {
+        if(worker->exited) { continue; }
+        int64_t busy = worker->busyNs.load(memory_order_relaxed);
+        int64_t span = now - worker->lastNs;
+        metrics.busyRatio.push_back(span > 0 ? double(busy - worker->lastBusyNs) / span : 0);
+        worker->lastBusyNs = busy;
+        worker->lastNs = now;
+    }
+    return metrics;
+}
+
+uint64_t ThreadPool::Metrics::WaitPercentileUs(double p) const {
+    uint64_t total = 0;
+    for(uint64_t count: waitHist) {
+        total += count;
+    }
+    if(total == 0) { return 0; }
+    uint64_t target = static_cast<uint64_t>(p * total);
+    uint64_t sum = 0;
+    for(int i = 0; i < HIST_NUM; i++) {
+        sum += waitHist[i];
+        if(sum > target) {
+            return 1ull << i;
+        }
+    }
+    return 1ull << (HIST_NUM - 1);
+}
@@ -9,65 +9,157 @@
 
 #include <mutex>
 #include <condition_variable>
-#include <queue>
 #include <thread>
-#include <functional>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <assert.h>
+#include "task.h"
+#include "mpmcqueue.h"
+
+/* 任务队列是有界的无锁MPMC环形队列，提交和取任务都不加锁；
+ * 队列满时TryAddTask返回false，由调用者决定等待、推迟还是拒绝。
+ * 锁和条件变量只用于空闲线程休眠，提交任务时只在有线程休眠时才加锁唤醒。
+ * 任务分快慢两条通道，各有自己的队列和线程：会长时间阻塞的任务(数据库)走慢速通道，
+ * 不会占满处理静态文件的线程；慢速通道没有线程时和快速通道共用。
+ * 线程数可以在初始值和上限之间伸缩：任务排队太久时增加线程，线程空闲太久时退出。
+ * 析构时执行完队列中剩余的任务，并回收所有线程 */
 class ThreadPool {
 public:
-    explicit ThreadPool(size_t threadCount = 8): pool_(std::make_shared<Pool>()) {
-            assert(threadCount > 0);
-            for(size_t i = 0; i < threadCount; i++) {
-                std::thread([pool = pool_] {
-                    std::unique_lock<std::mutex> locker(pool->mtx);
-                    while(true) {
-                        // 如果线程池中的任务不为空，则取出一个任务，然后执行
-                        if(!pool->tasks.empty()) {
-                            auto task = std::move(pool->tasks.front());
-                            pool->tasks.pop();
-                            locker.unlock();
-                            task();
-                            locker.lock();
-                        } 
-                        else if(pool->isClosed) break;
-                        else pool->cond.wait(locker);
-                    }
-                }).detach();
-            }
-    }
+    enum Lane {
+        FAST = 0,   // 静态文件等CPU密集的短任务
+        SLOW,       // 会阻塞在数据库等外部I/O上的任务
+        LANE_NUM,
+    };
+
+    // 弹性伸缩参数，maxThreads不大于初始线程数时线程数固定
+    struct Elastic {
+        size_t maxThreads = 0;
+        int64_t growWaitUs = 2000;   // 任务排队超过该时间时增加一个线程，同一时间段内最多加一个
+        int64_t idleMs = 30000;      // 多出来的线程空闲超过该时间后退出
+    };
+
+    static const int HIST_NUM = 21;
+
+    // 一条通道的运行统计
+    struct Metrics {
+        size_t threads = 0;           // 当前线程数
+        size_t queueDepth = 0;        // 排队的任务数
+        uint64_t tasks = 0;           // 已执行的任务数
+        uint64_t waitHist[HIST_NUM] = {0};  // 排队时间直方图，第0格不到1微秒，第i格为[2^(i-1), 2^i)微秒
+        std::vector<double> busyRatio;      // 每个线程自上次统计以来执行任务的时间占比
+
+        // 排队时间的p分位(0~1)，返回所在格的上界(微秒)
+        uint64_t WaitPercentileUs(double p) const;
+    };
+
+    explicit ThreadPool(size_t threadCount = 8, size_t queueSize = 4096, size_t slowThreadCount = 0);
+
+    ThreadPool(size_t threadCount, size_t queueSize, size_t slowThreadCount, const Elastic &elastic);
 
     ThreadPool() = default;
 
     ThreadPool(ThreadPool&&) = default;
     
-    ~ThreadPool() {
-        if(static_cast<bool>(pool_)) {
-            {
-                std::lock_guard<std::mutex> locker(pool_->mtx);
-                pool_->isClosed = true;
-            }
-            pool_->cond.notify_all();
+    ~ThreadPool();
+
+    // 增加一个任务，队列满时等待
+    template<class F>
+    void AddTask(F&& task, Lane lane = FAST) {
+        Pool &pool = *lanes_[lane];
+        Item item{Task(std::forward<F>(task)), NowNs_()};
+        int64_t now = item.enqueueNs;
+        while(!pool.tasks.TryPush(std::move(item))) {
+            std::this_thread::yield();
         }
+        pool.Notify(now);
     }
 
-    // 增加一个任务
+    // 尝试增加一个任务，队列满时返回false
     template<class F>
-    void AddTask(F&& task) {
-        {
-            std::lock_guard<std::mutex> locker(pool_->mtx);
-            pool_->tasks.emplace(std::forward<F>(task));
+    bool TryAddTask(F&& task, Lane lane = FAST) {
+        Pool &pool = *lanes_[lane];
+        int64_t now = NowNs_();
+        if(!pool.tasks.TryPush(Item{Task(std::forward<F>(task)), now})) {
+            return false;
         }
-        pool_->cond.notify_one();
+        pool.Notify(now);
+        return true;
     }
 
+    // 队列中等待执行的任务数(近似值)
+    size_t QueueSize(Lane lane = FAST) const { return lanes_[lane]->tasks.Size(); }
+
+    // 慢速通道是否有自己的线程
+    bool HasSlowLane() const { return lanes_[SLOW] != lanes_[FAST]; }
+
+    Metrics GetMetrics(Lane lane = FAST) const;
+
 private:
+    static const int SPIN_ROUNDS = 64;  // 休眠前空转的轮数
+
+    struct Item {
+        Task task;
+        int64_t enqueueNs = 0;
+    };
+
+    struct Worker {
+        std::thread thread;
+        std::atomic<bool> exited{false};
+        std::atomic<int64_t> busyNs{0};   // 执行任务的累计时间
+        int64_t lastBusyNs = 0;           // 上次统计时的busyNs和时间，由mtx保护
+        int64_t lastNs = 0;
+    };
+
     struct Pool {
         std::mutex mtx;
         std::condition_variable cond;
-        bool isClosed;
-        std::queue<std::function<void()>> tasks;
+        std::atomic<bool> isClosed{false};
+        std::atomic<int> sleepers{0};
+        MpmcQueue<Item> tasks;
+
+        /* 以下由mtx保护 */
+        std::vector<std::unique_ptr<Worker>> workers;  // 包括已退出、还没回收的线程
+        size_t threads = 0;                            // 运行中的线程数
+        size_t minThreads;
+        size_t maxThreads;
+
+        int64_t growWaitNs;
+        int64_t idleNs;
+        std::atomic<int64_t> lastGrowNs{0};
+        alignas(64) std::atomic<int64_t> lastPopNs{0};  // 最近一次取出任务的时间，精度为growWait的几分之一
+        std::atomic<int> idlers{0};                     // 没有在执行任务(自旋或休眠)的线程数
+        std::atomic<uint64_t> taskCount{0};
+        std::atomic<uint64_t> waitHist[HIST_NUM];
+
+        Pool(size_t threadCount, size_t queueSize, size_t maxThreadCount, const Elastic &elastic);
+
+        bool Park();
+
+        void Notify(int64_t now);
+
+        void Grow(int64_t now);
+
+        void Spawn();
+
+        void Reap();
+
+        void Close();
+
+        void Join();
     };
-    std::shared_ptr<Pool> pool_;
+
+    static void Run_(Pool *pool, Worker *worker);
+
+    static int64_t NowNs_() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::shared_ptr<Pool> lanes_[LANE_NUM];
 };
 
 
-#endif //THREADPOOL_H
\ No newline at end of file
+#endif //THREADPOOL_H
@@ -0,0 +1,113 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-15
+ * @copyleft Apache 2.0
+ */
+#ifndef WORK_DEQUE_H
+#define WORK_DEQUE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+/* Chase-Lev工作窃取双端队列
+ * 所有者在底部压入、弹出，不加锁；其他线程从顶部窃取，只有取最后一个元素时才与所有者CAS竞争。
+ * 元素必须是指针这类可以原子读写的类型，空队列或竞争失败时返回nullptr。
+ * 扩容后旧数组可能仍被窃取者读取，保留到队列析构时再释放 */
+template<class T>
+class WorkDeque {
+public:
+    explicit WorkDeque(size_t capacity = 256) : top_(0), bottom_(0) {
+        size_t size = 2;
+        while (size < capacity) { size <<= 1; }
+        arrays_.emplace_back(new Array(size));
+        array_.store(arrays_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkDeque(const WorkDeque &) = delete;
+
+    WorkDeque &operator=(const WorkDeque &) = delete;
+
+    // 只能由所有者调用
+    void Push(T value) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array *a = array_.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(a->mask)) {
+            a = Grow_(a, t, b);
+        }
+        a->Put(b, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // 只能由所有者调用，后进先出
+    T Pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array *a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T value = a->Get(b);
+        if (t == b) {
+            /* 最后一个元素，和窃取者竞争 */
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                value = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    // 任意线程调用，先进先出
+    T Steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) { return nullptr; }
+        Array *a = array_.load(std::memory_order_acquire);
+        T value = a->Get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return value;
+    }
+
+    bool Empty() const {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array {
+        size_t mask;
+        std::unique_ptr<std::atomic<T>[]> buf;
+
+        explicit Array(size_t size) : mask(size - 1), buf(new std::atomic<T>[size]) {}
+
+        T Get(int64_t i) const { return buf[i & mask].load(std::memory_order_relaxed); }
+
+        void Put(int64_t i, T value) { buf[i & mask].store(value, std::memory_order_relaxed); }
+    };
+
+    Array *Grow_(Array *old, int64_t t, int64_t b) {
+        arrays_.emplace_back(new Array((old->mask + 1) * 2));
+        Array *a = arrays_.back().get();
+        for (int64_t i = t; i < b; i++) {
+            a->Put(i, old->Get(i));
+        }
+        array_.store(a, std::memory_order_release);
+        return a;
+    }
+
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Array *> array_;
+    std::vector<std::unique_ptr<Array>> arrays_;  // 只有所有者修改
+};
+
+#endif //WORK_DEQUE_H
@@ -0,0 +1,79 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-17
+ * @copyleft Apache 2.0
+ */
+#ifndef CONN_TABLE_H
+#define CONN_TABLE_H
+
+#include <stdlib.h>      // calloc, free
+#include <stdint.h>
+#include <assert.h>
+#include <new>
+#include <type_traits>
+#include "../http/httpconn.h"
+
+/* 按fd下标直接索引的连接表
+ * fd是稠密的小整数，一次性分配MAX_FD个槽位，事件分发只需一次下标访问，
+ * 槽位地址在整个生命周期内不变，不存在哈希表扩容导致的指针失效。
+ * 内存用calloc申请，未使用过的槽位不会真正占用物理页，HttpConn在槽位第一次被使用时才构造 */
+class ConnTable {
+public:
+    explicit ConnTable(size_t maxFd) : maxFd_(maxFd) {
+        slots_ = static_cast<Slot *>(calloc(maxFd_, sizeof(Slot)));
+        assert(slots_);
+    }
+
+    ~ConnTable() {
+        for (size_t i = 0; i < maxFd_; i++) {
+            if (slots_[i].constructed) {
+                Conn_(i)->~HttpConn();
+            }
+        }
+        free(slots_);
+    }
+
+    ConnTable(const ConnTable &) = delete;
+
+    ConnTable &operator=(const ConnTable &) = delete;
+
+    // 新连接占用fd对应的槽位，代数加一
+    HttpConn *Acquire(int fd) {
+        assert(fd >= 0 && static_cast<size_t>(fd) < maxFd_);
+        Slot &slot = slots_[fd];
+        if (!slot.constructed) {
+            new(&slot.storage) HttpConn();
+            slot.constructed = true;
+        }
+        __atomic_add_fetch(&slot.gen, 1, __ATOMIC_RELEASE);
+        return Conn_(fd);
+    }
+
+    // 取出fd对应的连接，槽位从未被使用过时返回nullptr
+    HttpConn *Get(int fd) const {
+        assert(fd >= 0 && static_cast<size_t>(fd) < maxFd_);
+        return slots_[fd].constructed ? Conn_(fd) : nullptr;
+    }
+
+    // 槽位当前的代数，用于识别fd被关闭后又被新连接复用的情况
+    uint32_t Generation(int fd) const {
+        assert(fd >= 0 && static_cast<size_t>(fd) < maxFd_);
+        return __atomic_load_n(&slots_[fd].gen, __ATOMIC_ACQUIRE);
+    }
+
+private:
+    struct Slot {
+        typename std::aligned_storage<sizeof(HttpConn), alignof(HttpConn)>::type storage;
+        bool constructed;
+        uint32_t gen;
+    };
+
+    HttpConn *Conn_(size_t i) const {
+        return reinterpret_cast<HttpConn *>(&slots_[i].storage);
+    }
+
+    size_t maxFd_;
+    Slot *slots_;
+};
+
+#endif //CONN_TABLE_H
@@ -12,24 +12,25 @@
 #include <assert.h> // close()
 #include <vector>
 #include <errno.h>
+#include "poller.h"
 
-class Epoller {
+class Epoller : public Poller {
 public:
     explicit Epoller(int maxEvent = 1024);
 
     ~Epoller();
 
-    bool AddFd(int fd, uint32_t events);
+    bool AddFd(int fd, uint32_t events) override;
 
-    bool ModFd(int fd, uint32_t events);
+    bool ModFd(int fd, uint32_t events) override;
 
-    bool DelFd(int fd);
+    bool DelFd(int fd) override;
 
-    int Wait(int timeoutMs = -1);
+    int Wait(int timeoutMs = -1) override;
 
-    int GetEventFd(size_t i) const;
+    int GetEventFd(size_t i) const override;
 
-    uint32_t GetEvents(size_t i) const;
+    uint32_t GetEvents(size_t i) const override;
         
 private:
     int epollFd_;
@@ -0,0 +1,30 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-15
+ * @copyleft Apache 2.0
+ */ 
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// IO多路复用的抽象接口，事件掩码统一使用EPOLL*的取值
+class Poller {
+public:
+    virtual ~Poller() = default;
+
+    virtual bool AddFd(int fd, uint32_t events) = 0;
+
+    virtual bool ModFd(int fd, uint32_t events) = 0;
+
+    virtual bool DelFd(int fd) = 0;
+
+    virtual int Wait(int timeoutMs = -1) = 0;
+
+    virtual int GetEventFd(size_t i) const = 0;
+
+    virtual uint32_t GetEvents(size_t i) const = 0;
+};
+
+#endif //POLLER_H
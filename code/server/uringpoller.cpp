@@ -0,0 +1,297 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-19
+ * @copyleft Apache 2.0
+ */
+
+#include "uringpoller.h"
+
+UringPoller::UringPoller(int maxEvent) :
+        ringFd_(-1), sqRing_(MAP_FAILED), cqRing_(MAP_FAILED),
+        sqRingSize_(0), cqRingSize_(0), sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)), sqesSize_(0),
+        pending_(0), wakeFd_(-1), wakeBuf_(0), sleeping_(false), wakeSent_(false),
+        enters_(0), wakes_(0), fds_(1024), events_(maxEvent) {
+    assert(events_.size() > 0);
+    if (!InitRing_(static_cast<unsigned>(maxEvent))) { return; }
+    /* 不能设置EFD_NONBLOCK，否则io_uring的READ在计数为0时直接返回-EAGAIN，而不是挂起等待 */
+    wakeFd_ = eventfd(0, EFD_CLOEXEC);
+    if (wakeFd_ < 0) {
+        UnmapRing_();
+        close(ringFd_);
+        ringFd_ = -1;
+        return;
+    }
+    ArmWake_();
+}
+
+UringPoller::~UringPoller() {
+    if (wakeFd_ >= 0) { close(wakeFd_); }
+    UnmapRing_();
+    if (ringFd_ >= 0) { close(ringFd_); }
+}
+
+bool UringPoller::InitRing_(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) { return false; }
+    ringFd_ = fd;
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        /* 需要5.11以上的内核，才能在io_uring_enter中同时提交和带超时等待 */
+        goto fail;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        /* SQ与CQ共用一次映射 */
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = mmap(0, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) { goto fail; }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(0, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) { goto fail; }
+    }
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(mmap(0, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                             ringFd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) { goto fail; }
+
+    sqHead_ = reinterpret_cast<unsigned *>(static_cast<char *>(sqRing_) + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(static_cast<char *>(sqRing_) + params.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned *>(static_cast<char *>(sqRing_) + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned *>(static_cast<char *>(sqRing_) + params.sq_off.array);
+    sqEntries_ = params.sq_entries;
+    cqHead_ = reinterpret_cast<unsigned *>(static_cast<char *>(cqRing_) + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(static_cast<char *>(cqRing_) + params.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned *>(static_cast<char *>(cqRing_) + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(static_cast<char *>(cqRing_) + params.cq_off.cqes);
+    return true;
+
+fail:
+    UnmapRing_();
+    close(ringFd_);
+    ringFd_ = -1;
+    return false;
+}
+
+void UringPoller::UnmapRing_() {
+    if (sqes_ != MAP_FAILED) { munmap(sqes_, sqesSize_); }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) { munmap(cqRing_, cqRingSize_); }
+    if (sqRing_ != MAP_FAILED) { munmap(sqRing_, sqRingSize_); }
+    sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+    sqRing_ = cqRing_ = MAP_FAILED;
+}
+
+bool UringPoller::AddFd(int fd, uint32_t events) {
+    if (fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState &state = State_(fd);
+    if (state.armed) {
+        PollRemove_(fd, state);
+    }
+    state.events = events;
+    PollAdd_(fd, state);
+    Flush_();
+    return true;
+}
+
+bool UringPoller::ModFd(int fd, uint32_t events) {
+    if (fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState &state = State_(fd);
+    /* EPOLLONESHOT的fd在事件触发后就已经不在内核中了，只需要重新挂一个poll */
+    if (state.armed) {
+        PollRemove_(fd, state);
+    }
+    state.events = events;
+    PollAdd_(fd, state);
+    Flush_();
+    return true;
+}
+
+bool UringPoller::DelFd(int fd) {
+    if (fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    FdState &state = State_(fd);
+    if (state.armed) {
+        PollRemove_(fd, state);
+    }
+    /* 递增代数，fd关闭后被复用时旧请求的完成事件会被丢弃 */
+    state.gen++;
+    state.events = 0;
+    Flush_();
+    return true;
+}
+
+int UringPoller::Wait(int timeoutMs) {
+    unsigned toSubmit;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        loopId_ = std::this_thread::get_id();
+        toSubmit = pending_;
+        pending_ = 0;
+        sleeping_ = true;
+    }
+    /* 提交攒下的SQE并等待至少一个完成事件，只需一次系统调用 */
+    int ret = Enter_(toSubmit, 1, timeoutMs);
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    sleeping_ = false;
+    /* 内核没有接收的SQE仍留在SQ中，计回pending_，下次一起提交 */
+    unsigned submitted = ret > 0 ? static_cast<unsigned>(ret) : 0;
+    if (submitted < toSubmit) {
+        pending_ += toSubmit - submitted;
+    }
+    int n = 0;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    while (head != tail && n < static_cast<int>(events_.size())) {
+        const struct io_uring_cqe &cqe = cqes_[head & *cqMask_];
+        head++;
+        if (cqe.user_data & REMOVE_TAG) { continue; }
+        if (cqe.user_data == WAKE_TAG) {
+            /* 工作线程的唤醒：它们填入的SQE在下一次Wait时提交，这里只需要重新挂上READ */
+            wakeSent_ = false;
+            ArmWake_();
+            continue;
+        }
+        int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+        uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32);
+        FdState &state = State_(fd);
+        if (gen != (state.gen & 0x7fffffff)) { continue; }  /* 已删除或已重新注册 */
+        state.armed = false;
+        if (!(state.events & EPOLLONESHOT)) {
+            /* io_uring的poll请求触发一次就失效，非oneshot的fd(如监听socket)要重新挂上，
+             * 挂载失败时也要重试，否则该fd再也不会有事件 */
+            PollAdd_(fd, state);
+        }
+        if (cqe.res == 0) { continue; }
+        events_[n].data.fd = fd;
+        /* poll请求失败(如-ENOMEM、-EBADF)时按EPOLLERR上报，由上层关闭连接，
+         * 不能直接丢弃，否则oneshot的连接没有任何注册，只能等超时 */
+        events_[n].events = cqe.res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe.res);
+        n++;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    Flush_();
+    return n;
+}
+
+int UringPoller::GetEventFd(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].data.fd;
+}
+
+uint32_t UringPoller::GetEvents(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].events;
+}
+
+struct io_uring_sqe *UringPoller::GetSqe_() {
+    unsigned tail = *sqTail_;
+    while (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+        /* SQ已满，先把已有的提交掉；内核暂时不接收(EINTR、EBUSY)时重试，不能覆盖未提交的SQE */
+        if (!Submit_()) {
+            std::this_thread::yield();
+        }
+    }
+    unsigned index = tail & *sqMask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    return sqe;
+}
+
+void UringPoller::PollAdd_(int fd, FdState &state) {
+    struct io_uring_sqe *sqe = GetSqe_();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    /* poll本身是水平触发，ET模式下HttpConn也会一直读到EAGAIN，因此去掉ET标记 */
+    sqe->poll32_events = state.events & ~(EPOLLONESHOT | EPOLLET);
+    sqe->user_data = MakeUserData_(fd, state.gen);
+    state.armed = true;
+    __atomic_store_n(sqTail_, *sqTail_ + 1, __ATOMIC_RELEASE);
+    pending_++;
+}
+
+void UringPoller::PollRemove_(int fd, FdState &state) {
+    struct io_uring_sqe *sqe = GetSqe_();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = MakeUserData_(fd, state.gen);
+    sqe->user_data = REMOVE_TAG;
+    state.armed = false;
+    state.gen++;
+    __atomic_store_n(sqTail_, *sqTail_ + 1, __ATOMIC_RELEASE);
+    pending_++;
+}
+
+void UringPoller::ArmWake_() {
+    struct io_uring_sqe *sqe = GetSqe_();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeFd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeBuf_);
+    sqe->len = sizeof(wakeBuf_);
+    sqe->off = static_cast<uint64_t>(-1);
+    sqe->user_data = WAKE_TAG;
+    __atomic_store_n(sqTail_, *sqTail_ + 1, __ATOMIC_RELEASE);
+    pending_++;
+}
+
+/* 所有修改都留到事件循环下一次Wait时合并提交
+ * 其他线程(线程池)修改时事件循环如果正阻塞着，要唤醒它来提交，已经唤醒过就不用再唤醒 */
+void UringPoller::Flush_() {
+    if (pending_ == 0 || !sleeping_ || wakeSent_ || std::this_thread::get_id() == loopId_) { return; }
+    uint64_t one = 1;
+    if (write(wakeFd_, &one, sizeof(one)) == sizeof(one)) {
+        wakeSent_ = true;
+        wakes_++;
+    }
+}
+
+// 提交pending_个SQE，只扣除内核实际接收的数量，一个都没有提交时返回false
+bool UringPoller::Submit_() {
+    int ret = Enter_(pending_, 0, -1);
+    if (ret <= 0) {
+        return false;
+    }
+    pending_ -= std::min(static_cast<unsigned>(ret), pending_);
+    return true;
+}
+
+int UringPoller::Enter_(unsigned toSubmit, unsigned minComplete, int timeoutMs) {
+    enters_++;
+    unsigned flags = minComplete ? IORING_ENTER_GETEVENTS : 0;
+    if (minComplete && timeoutMs >= 0) {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete,
+                                        flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)));
+    }
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+UringPoller::FdState &UringPoller::State_(int fd) {
+    assert(fd >= 0);
+    if (static_cast<size_t>(fd) >= fds_.size()) {
+        fds_.resize(fd * 2 + 1);
+    }
+    return fds_[fd];
+}
+
+uint64_t UringPoller::MakeUserData_(int fd, uint32_t gen) {
+    return (static_cast<uint64_t>(gen & 0x7fffffff) << 32) | static_cast<uint32_t>(fd);
+}
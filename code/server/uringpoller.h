@@ -0,0 +1,124 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-15
+ * @copyleft Apache 2.0
+ */
+#ifndef URING_POLLER_H
+#define URING_POLLER_H
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>    // mmap, munmap
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "poller.h"
+
+/* 基于io_uring的事件后端，接口与Epoller一致
+ * 每次注册/修改事件只是往SQ中填一个POLL_ADD，不再单独调用epoll_ctl，
+ * 所有线程的修改都攒到事件循环下一次Wait时与等待合并成一次io_uring_enter；
+ * 工作线程重新注册时如果事件循环正阻塞在等待中，用eventfd唤醒它，一次阻塞期间最多唤醒一次 */
+class UringPoller : public Poller {
+public:
+    explicit UringPoller(int maxEvent = 1024);
+
+    ~UringPoller();
+
+    // 内核不支持io_uring时返回false，调用方应回退到Epoller
+    bool IsValid() const { return ringFd_ >= 0; }
+
+    bool AddFd(int fd, uint32_t events) override;
+
+    bool ModFd(int fd, uint32_t events) override;
+
+    bool DelFd(int fd) override;
+
+    int Wait(int timeoutMs = -1) override;
+
+    int GetEventFd(size_t i) const override;
+
+    uint32_t GetEvents(size_t i) const override;
+
+    // 调用io_uring_enter和唤醒事件循环的次数，用于统计系统调用
+    size_t Enters() const { return enters_; }
+
+    size_t Wakes() const { return wakes_; }
+
+private:
+    // 每个fd的注册状态
+    struct FdState {
+        uint32_t gen = 0;       // 代数，fd被删除或重新注册时递增，用于丢弃过期的完成事件
+        uint32_t events = 0;    // 注册的事件
+        bool armed = false;     // 内核中是否还挂着该fd的poll请求
+    };
+
+    bool InitRing_(unsigned entries);
+
+    void UnmapRing_();
+
+    struct io_uring_sqe *GetSqe_();
+
+    void PollAdd_(int fd, FdState &state);
+
+    void PollRemove_(int fd, FdState &state);
+
+    void ArmWake_();
+
+    void Flush_();
+
+    bool Submit_();
+
+    int Enter_(unsigned toSubmit, unsigned minComplete, int timeoutMs);
+
+    FdState &State_(int fd);
+
+    static uint64_t MakeUserData_(int fd, uint32_t gen);
+
+    static const uint64_t REMOVE_TAG = 1ULL << 63;
+    static const uint64_t WAKE_TAG = 1ULL << 62;
+
+    int ringFd_;
+
+    void *sqRing_;
+    void *cqRing_;
+    size_t sqRingSize_;
+    size_t cqRingSize_;
+    struct io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned *sqMask_;
+    unsigned *sqArray_;
+    unsigned sqEntries_;
+
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned *cqMask_;
+    struct io_uring_cqe *cqes_;
+
+    unsigned pending_;  // 已填入SQ但尚未提交的SQE数量
+    std::thread::id loopId_;    // 调用Wait的事件循环线程
+    std::mutex mtx_;
+
+    int wakeFd_;        // 唤醒事件循环的eventfd，内核中一直挂着一个对它的READ
+    uint64_t wakeBuf_;
+    bool sleeping_;     // 事件循环正阻塞在io_uring_enter中
+    bool wakeSent_;     // 已经唤醒过，READ的完成事件还没处理
+
+    std::atomic<size_t> enters_;
+    std::atomic<size_t> wakes_;
+
+    std::vector<FdState> fds_;
+    std::vector<struct epoll_event> events_;
+};
+
+#endif //URING_POLLER_H
@@ -12,18 +12,66 @@ WebServer::WebServer(
         int port, int trigMode, int timeoutMS, bool OptLinger,
         int sqlPort, const char *sqlUser, const char *sqlPwd,
         const char *dbName, int connPoolNum, int threadNum,
-        bool openLog, int logLevel, int logQueSize) :
+        bool openLog, int logLevel, int logQueSize, const Config &config) :
         port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
-        timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller()) {
+        oneLoopPerThread_(config.reactorNum > 0), rejectOverload_(config.rejectOverload), signalFd_(-1),
+        metricsIntervalMS_(config.metricsIntervalMS), nextMetricsMS_(0), users_(MAX_FD) {
+    if (config.preload) {
+        /* 在创建任何线程之前屏蔽SIGHUP，之后创建的线程都继承，信号只通过signalfd读取 */
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGHUP);
+        pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+        signalFd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    }
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strncat(srcDir_, "/resources/", 16);
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
+    HttpConn::releaseIdle = config.releaseIdleBuffer;
+    HttpConn::idleBytes = 0;
+    HttpResponse::sendfileThreshold = config.sendfileThreshold;
+    Deflater::level = config.gzip ? config.gzipLevel : 0;
+    Deflater::minSize = config.gzipMinSize;
+    Deflater::maxSize = config.gzipMaxSize;
+    if (config.precompress) {
+        Precompressor::Run(srcDir_, config.precompressMinSize);
+    }
+    FileCache::Instance()->Init(srcDir_, config.fileCacheSize, config.fileCacheFds);
+    bool preloaded = config.preload && FileCache::Instance()->Preload();
+    HttpResponse::LoadErrorPages(srcDir_);
     SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
 
     InitEventMode_(trigMode);
-    if (!InitSocket_()) { isClose_ = true; }
+    int reactorNum = oneLoopPerThread_ ? config.reactorNum : 1;
+    for (int i = 0; i < reactorNum; i++) {
+        reactors_.emplace_back(new Reactor());
+        if (config.timeWheel) {
+            reactors_.back()->timer.reset(new TimeWheel());
+        } else {
+            reactors_.back()->timer.reset(new HeapTimer());
+        }
+        reactors_.back()->epoller = CreatePoller_(config.ioUring);
+        if (!InitSocket_(reactors_.back().get())) {
+            isClose_ = true;
+            break;
+        }
+    }
+    if (!isClose_ && signalFd_ >= 0) {
+        reactors_[0]->epoller->AddFd(signalFd_, EPOLLIN);
+    }
+    if (!oneLoopPerThread_) {
+        if (config.workStealing) {
+            stealingPool_.reset(new StealingPool(threadNum, config.taskQueueSize));
+        } else {
+            ThreadPool::Elastic elastic;
+            elastic.maxThreads = config.threadMaxNum > 0 ? config.threadMaxNum : 0;
+            elastic.growWaitUs = config.threadGrowWaitUS;
+            elastic.idleMs = config.threadIdleMS;
+            threadpool_.reset(new ThreadPool(threadNum, config.taskQueueSize, config.dbThreadNum, elastic));
+        }
+    }
 
     if (openLog) {
         Log::Instance()->init(logLevel, "./log", ".log", logQueSize);
@@ -34,15 +82,38 @@ WebServer::WebServer(
             LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
                      (listenEvent_ & EPOLLET ? "ET" : "LT"),
                      (connEvent_ & EPOLLET ? "ET" : "LT"));
+            LOG_INFO("Poller: %s", (dynamic_cast<UringPoller *>(reactors_[0]->epoller.get()) ? "io_uring" : "epoll"));
+            LOG_INFO("Timer: %s", config.timeWheel ? "TimeWheel" : "HeapTimer");
+            LOG_INFO("Sendfile threshold: %zu, FileCache size: %zu, fds: %zu", config.sendfileThreshold,
+                     config.fileCacheSize, config.fileCacheFds);
+            LOG_INFO("Release idle buffer: %s", config.releaseIdleBuffer ? "true" : "false");
+            LOG_INFO("Preload: %s, Precompress: %s, Gzip level: %d", preloaded ? "true" : "false",
+                     config.precompress ? "true" : "false", Deflater::level);
             LOG_INFO("LogSys level: %d", logLevel);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            if (oneLoopPerThread_) {
+                LOG_INFO("SqlConnPool num: %d, Reactor num: %d", connPoolNum, reactorNum);
+            } else {
+                LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d%s, DB lane num: %d", connPoolNum, threadNum,
+                         stealingPool_ ? " (work stealing)" : "",
+                         threadpool_ && threadpool_->HasSlowLane() ? config.dbThreadNum : 0);
+                LOG_INFO("Task queue: %zu, when full: %s", config.taskQueueSize,
+                         rejectOverload_ ? "503" : "defer");
+                LOG_INFO("ThreadPool max num: %d, Metrics interval: %dms", max(config.threadMaxNum, threadNum),
+                         metricsIntervalMS_);
+            }
         }
     }
 }
 
 WebServer::~WebServer() {
-    close(listenFd_);
+    /* 先等线程池执行完手上的任务，它们还在使用连接表和数据库连接池 */
+    threadpool_.reset();
+    stealingPool_.reset();
+    for (auto &reactor: reactors_) {
+        if (reactor->listenFd >= 0) { close(reactor->listenFd); }
+    }
+    if (signalFd_ >= 0) { close(signalFd_); }
     isClose_ = true;
     // 为什么要free掉，并没有创建或者malloc
     free(srcDir_);
@@ -73,34 +144,77 @@ void WebServer::InitEventMode_(int trigMode) {
     HttpConn::isET = (connEvent_ & EPOLLET);
 }
 
+// 创建事件后端，内核不支持io_uring时回退到epoll
+std::unique_ptr<Poller> WebServer::CreatePoller_(bool ioUring) {
+    if (ioUring) {
+        std::unique_ptr<UringPoller> poller(new UringPoller());
+        if (poller->IsValid()) {
+            return std::move(poller);
+        }
+    }
+    return std::unique_ptr<Poller>(new Epoller());
+}
+
 // 开始函数
 void WebServer::Start() {
-    int timeMS = -1;  /* epoll wait timeout == -1 无事件将阻塞 */
     if (!isClose_) { LOG_INFO("========== Server start =========="); }
+    // 其余Reactor各自占用一个线程，第一个Reactor在主线程中运行
+    std::vector<std::thread> loops;
+    for (size_t i = 1; i < reactors_.size(); i++) {
+        loops.emplace_back(&WebServer::Loop_, this, reactors_[i].get());
+    }
+    Loop_(reactors_[0].get());
+    for (auto &loop: loops) {
+        loop.join();
+    }
+}
+
+// 单个Reactor的事件循环
+void WebServer::Loop_(Reactor *reactor) {
+    int timeMS = -1;  /* epoll wait timeout == -1 无事件将阻塞 */
     while (!isClose_) {
         if (timeoutMS_ > 0) {
-            timeMS = timer_->GetNextTick();
+            timeMS = reactor->timer->GetNextTick();
+        }
+        int waitMS = timeMS;
+        if (!reactor->deferred.empty() && (waitMS < 0 || waitMS > 1)) {
+            /* 有推迟的事件时最多等1ms就重试 */
+            waitMS = 1;
+        }
+        bool reporter = metricsIntervalMS_ > 0 && reactor == reactors_[0].get();
+        if (reporter && (waitMS < 0 || waitMS > metricsIntervalMS_)) {
+            waitMS = metricsIntervalMS_;
+        }
+        int eventCnt = reactor->epoller->Wait(waitMS);
+        HttpResponse::UpdateDate();
+        RetryDeferred_(reactor);
+        if (reporter) {
+            ReportMetrics_();
         }
-        int eventCnt = epoller_->Wait(timeMS);
         for (int i = 0; i < eventCnt; i++) {
             /* 处理事件 */
-            int fd = epoller_->GetEventFd(i);
-            uint32_t events = epoller_->GetEvents(i);
+            int fd = reactor->epoller->GetEventFd(i);
+            uint32_t events = reactor->epoller->GetEvents(i);
             // 如果是监听事件，则处理监听
-            if (fd == listenFd_) {
-                DealListen_();
-            } else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            if (fd == reactor->listenFd) {
+                DealListen_(reactor);
+                continue;
+            }
+            if (fd == signalFd_) {
+                DealSignal_();
+                continue;
+            }
+            HttpConn *client = users_.Get(fd);
+            assert(client);
+            if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
                 // 关闭连接事件 TODO:这几个参数都代表什么意思
-                assert(users_.count(fd) > 0);
-                CloseConn_(&users_[fd]);
+                CloseConn_(reactor, client);
             } else if (events & EPOLLIN) {
                 // 读事件
-                assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]);
+                DealRead_(reactor, client);
             } else if (events & EPOLLOUT) {
                 // 写事件
-                assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);
+                DealWrite_(reactor, client);
             } else {
                 LOG_ERROR("Unexpected event");
             }
@@ -108,6 +222,48 @@ void WebServer::Start() {
     }
 }
 
+// 收到SIGHUP时在后台重新预加载资源目录，新的预加载区建好后才替换旧的，事件循环不等待
+void WebServer::DealSignal_() {
+    struct signalfd_siginfo info;
+    bool reload = false;
+    while (read(signalFd_, &info, sizeof(info)) == sizeof(info)) {
+        reload |= (info.ssi_signo == SIGHUP);
+    }
+    if (reload) {
+        LOG_INFO("SIGHUP, reload resources");
+        std::string srcDir = srcDir_;
+        FileCache::Instance()->PreloadAsync([srcDir] { HttpResponse::LoadErrorPages(srcDir); });
+    }
+}
+
+// 到时间时在日志中输出线程池和缓冲区内存的统计
+void WebServer::ReportMetrics_() {
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now < nextMetricsMS_) { return; }
+    nextMetricsMS_ = now + metricsIntervalMS_;
+    if (threadpool_) {
+        for (int lane = 0; lane < (threadpool_->HasSlowLane() ? 2 : 1); lane++) {
+            ThreadPool::Metrics metrics = threadpool_->GetMetrics(static_cast<ThreadPool::Lane>(lane));
+            string busy;
+            char ratio[16];
+            for (double r: metrics.busyRatio) {
+                snprintf(ratio, sizeof(ratio), " %.2f", r);
+                busy += ratio;
+            }
+            LOG_INFO("ThreadPool %s: threads %zu, queue %zu, tasks %llu, wait p50 <%lluus p99 <%lluus, busy%s",
+                     lane == ThreadPool::FAST ? "fast" : "slow", metrics.threads, metrics.queueDepth,
+                     (unsigned long long) metrics.tasks,
+                     (unsigned long long) metrics.WaitPercentileUs(0.5),
+                     (unsigned long long) metrics.WaitPercentileUs(0.99), busy.data());
+        }
+    } else if (stealingPool_) {
+        LOG_INFO("StealingPool: queue %zu", stealingPool_->QueueSize());
+    }
+    LOG_INFO("Buffer: pool used %zu, slab %zu, idle conn %zu", BlockPool::UsedBytes(), BlockPool::SlabBytes(),
+             (size_t) HttpConn::idleBytes);
+}
+
 // 发送错误消息
 void WebServer::SendError_(int fd, const char *info) {
     assert(fd > 0);
@@ -119,94 +275,188 @@ void WebServer::SendError_(int fd, const char *info) {
 }
 
 // 关闭客户端连接
-void WebServer::CloseConn_(HttpConn *client) {
-    assert(client);
+void WebServer::CloseConn_(Reactor *reactor, HttpConn *client) {
+    assert(reactor && client);
     LOG_INFO("Client[%d] quit!", client->GetFd());
     // 将客户端对应的fd从epoll中删除
-    epoller_->DelFd(client->GetFd());
+    reactor->epoller->DelFd(client->GetFd());
     client->Close();
 }
 
+// 连接超时，fd已被新连接复用(代数不同)时不做处理
+void WebServer::OnTimeout_(Reactor *reactor, int fd, uint32_t gen) {
+    if (users_.Generation(fd) != gen) { return; }
+    CloseConn_(reactor, users_.Get(fd));
+}
+
 // 增加客户端
-void WebServer::AddClient_(int fd, sockaddr_in addr) {
+void WebServer::AddClient_(Reactor *reactor, int fd, sockaddr_in addr) {
     assert(fd > 0);
-    users_[fd].init(fd, addr);
+    HttpConn *client = users_.Acquire(fd);
+    client->init(fd, addr);
     if (timeoutMS_ > 0) {
         // 添加定时结点
-        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseConn_, this, &users_[fd]));
+        reactor->timer->add(fd, timeoutMS_, std::bind(&WebServer::OnTimeout_, this, reactor, fd, users_.Generation(fd)));
     }
     // 将该事件加入到epoll中
-    epoller_->AddFd(fd, EPOLLIN | connEvent_);
+    reactor->epoller->AddFd(fd, EPOLLIN | connEvent_);
     // 设置fd非阻塞
     SetFdNonblock(fd);
-    LOG_INFO("Client[%d] in!", users_[fd].GetFd());
+    LOG_INFO("Client[%d] in!", client->GetFd());
 }
 
 // 处理监听事件
-void WebServer::DealListen_() {
+void WebServer::DealListen_(Reactor *reactor) {
     struct sockaddr_in addr;
     socklen_t len = sizeof(addr);
     do {
         // 接受客户端连接
-        int fd = accept(listenFd_, (struct sockaddr *) &addr, &len);
+        int fd = accept(reactor->listenFd, (struct sockaddr *) &addr, &len);
         if (fd <= 0) { return; }
-        else if (HttpConn::userCount >= MAX_FD) {
+        else if (HttpConn::userCount >= MAX_FD || fd >= MAX_FD) {
             SendError_(fd, "Server busy!");
             LOG_WARN("Clients is full!");
             return;
         }
         // 添加客户端
-        AddClient_(fd, addr);
+        AddClient_(reactor, fd, addr);
     } while (listenEvent_ & EPOLLET);
 }
 
 // 处理读事件
-void WebServer::DealRead_(HttpConn *client) {
+void WebServer::DealRead_(Reactor *reactor, HttpConn *client) {
     assert(client);
-    ExtentTime_(client);
-    // 添加到线程池中进行处理
-    threadpool_->AddTask(std::bind(&WebServer::OnRead_, this, client));
+    ExtentTime_(reactor, client);
+    if (oneLoopPerThread_) {
+        // 连接只属于当前Reactor，直接在本线程处理
+        OnRead_(reactor, client);
+        return;
+    }
+    // 添加到线程池中进行处理，已有推迟的事件时排在它们后面；
+    // 拒绝模式下推迟的只有写事件，新请求照常提交，队列确实满了才回复503
+    bool behind = !rejectOverload_ && !reactor->deferred.empty();
+    if (behind || !Dispatch_(reactor, client, false)) {
+        Overload_(reactor, client, false);
+    }
 }
 
 // 处理写事件
-void WebServer::DealWrite_(HttpConn *client) {
+void WebServer::DealWrite_(Reactor *reactor, HttpConn *client) {
     assert(client);
-    ExtentTime_(client);
+    ExtentTime_(reactor, client);
+    if (oneLoopPerThread_) {
+        OnWrite_(reactor, client);
+        return;
+    }
     // 添加写事件
-    threadpool_->AddTask(std::bind(&WebServer::OnWrite_, this, client));
+    if (!reactor->deferred.empty() || !Dispatch_(reactor, client, true)) {
+        Overload_(reactor, client, true);
+    }
+}
+
+// 把读写事件交给线程池，队列满时返回false
+bool WebServer::Dispatch_(Reactor *reactor, HttpConn *client, bool write) {
+    if (!client->Pin()) {
+        // 连接已经关闭，事件不用再处理
+        return true;
+    }
+    // 回调只捕获三个指针，放在Task内部不分配内存
+    bool added;
+    if (write) {
+        auto task = [this, reactor, client] {
+            OnWrite_(reactor, client);
+            client->Unpin();
+        };
+        static_assert(Task::IsInline<decltype(task)>::value, "write task must not allocate");
+        added = TryAddTask_(std::move(task));
+    } else {
+        auto task = [this, reactor, client] {
+            OnRead_(reactor, client);
+            client->Unpin();
+        };
+        static_assert(Task::IsInline<decltype(task)>::value, "read task must not allocate");
+        added = TryAddTask_(std::move(task));
+    }
+    if (!added) {
+        client->Unpin();
+    }
+    return added;
+}
+
+// 线程池队列已满
+void WebServer::Overload_(Reactor *reactor, HttpConn *client, bool write) {
+    if (rejectOverload_ && !write) {
+        /* 新的请求直接回复503，已经生成的响应仍然推迟发送 */
+        static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\n"
+                                   "Content-length: 0\r\nConnection: close\r\n\r\n";
+        send(client->GetFd(), busy, sizeof(busy) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+        LOG_WARN("Task queue full, Client[%d] rejected", client->GetFd());
+        CloseConn_(reactor, client);
+        return;
+    }
+    /* EPOLLONESHOT的事件已经触发，不重新注册就不会再有该连接的事件，等队列有空位再交给线程池 */
+    reactor->deferred.push_back({client, users_.Generation(client->GetFd()), write});
+}
+
+// 按顺序重新提交推迟的事件，跳过期间已关闭或fd已被复用的连接
+void WebServer::RetryDeferred_(Reactor *reactor) {
+    while (!reactor->deferred.empty()) {
+        const Reactor::Deferred &deferred = reactor->deferred.front();
+        HttpConn *client = deferred.client;
+        if (!client->IsClose() && users_.Generation(client->GetFd()) == deferred.gen &&
+            !Dispatch_(reactor, client, deferred.write)) {
+            break;
+        }
+        reactor->deferred.pop_front();
+    }
 }
 
 // 扩展客户端事件
-void WebServer::ExtentTime_(HttpConn *client) {
+void WebServer::ExtentTime_(Reactor *reactor, HttpConn *client) {
     assert(client);
-    if (timeoutMS_ > 0) { timer_->adjust(client->GetFd(), timeoutMS_); }
+    if (timeoutMS_ > 0) { reactor->timer->adjust(client->GetFd(), timeoutMS_); }
 }
 
 // 读取事件处理函数
-void WebServer::OnRead_(HttpConn *client) {
+void WebServer::OnRead_(Reactor *reactor, HttpConn *client) {
     assert(client);
     int ret = -1;
     int readErrno = 0;
     // 客户端读取数据
     ret = client->read(&readErrno);
     if (ret <= 0 && readErrno != EAGAIN) {
-        CloseConn_(client);
+        CloseConn_(reactor, client);
         return;
     }
-    OnProcess(client);
+    if (threadpool_ && threadpool_->HasSlowLane() && client->NeedsDb()) {
+        /* 请求行表明要查询数据库，交给慢速通道，不阻塞处理静态文件的线程；慢速通道满时就地处理 */
+        auto task = [this, reactor, client] {
+            OnProcess(reactor, client);
+            client->Unpin();
+        };
+        static_assert(Task::IsInline<decltype(task)>::value, "db task must not allocate");
+        if (!client->Pin()) {
+            return;
+        }
+        if (threadpool_->TryAddTask(std::move(task), ThreadPool::SLOW)) {
+            return;
+        }
+        client->Unpin();
+    }
+    OnProcess(reactor, client);
 }
 
 // 完成读取或写数据之后对其进行处理
-void WebServer::OnProcess(HttpConn *client) {
+void WebServer::OnProcess(Reactor *reactor, HttpConn *client) {
     if (client->process()) {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+        reactor->epoller->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
     } else {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+        reactor->epoller->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
     }
 }
 
 // 写事件处理函数
-void WebServer::OnWrite_(HttpConn *client) {
+void WebServer::OnWrite_(Reactor *reactor, HttpConn *client) {
     assert(client);
     int ret = -1;
     int writeErrno = 0;
@@ -215,22 +465,22 @@ void WebServer::OnWrite_(HttpConn *client) {
     if (client->ToWriteBytes() == 0) {
         /* 传输完成 */
         if (client->IsKeepAlive()) {
-            OnProcess(client);
+            OnProcess(reactor, client);
             return;
         }
     } else if (ret < 0) {
         if (writeErrno == EAGAIN) {
             /* 继续传输 */
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+            reactor->epoller->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
             return;
         }
     }
-    CloseConn_(client);
+    CloseConn_(reactor, client);
 }
 
 /* Create listenFd */
 // 初始化服务器监听socket
-bool WebServer::InitSocket_() {
+bool WebServer::InitSocket_(Reactor *reactor) {
     int ret;
     struct sockaddr_in addr;
     if (port_ > 65535 || port_ < 1024) {
@@ -247,16 +497,16 @@ bool WebServer::InitSocket_() {
         optLinger.l_linger = 1;
     }
 
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenFd_ < 0) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
         LOG_ERROR("Create socket error!", port_);
         return false;
     }
 
     // 设置listenfd属性
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
     if (ret < 0) {
-        close(listenFd_);
+        close(listenFd);
         LOG_ERROR("Init linger error!", port_);
         return false;
     }
@@ -264,37 +514,48 @@ bool WebServer::InitSocket_() {
     int optval = 1;
     /* 端口复用 */
     /* 只有最后一个套接字会正常接收数据。 */
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void *) &optval, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void *) &optval, sizeof(int));
     if (ret == -1) {
         LOG_ERROR("set socket setsockopt error !");
-        close(listenFd_);
+        close(listenFd);
         return false;
     }
 
+    if (oneLoopPerThread_) {
+        /* 每个Reactor各自绑定同一端口，由内核在这些监听socket间均衡分发连接 */
+        ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, (const void *) &optval, sizeof(int));
+        if (ret == -1) {
+            LOG_ERROR("set socket SO_REUSEPORT error !");
+            close(listenFd);
+            return false;
+        }
+    }
+
     // 绑定fd
-    ret = bind(listenFd_, (struct sockaddr *) &addr, sizeof(addr));
+    ret = bind(listenFd, (struct sockaddr *) &addr, sizeof(addr));
     if (ret < 0) {
         LOG_ERROR("Bind Port:%d error!", port_);
-        close(listenFd_);
+        close(listenFd);
         return false;
     }
 
     // 监听，设置最大监听数为6
-    ret = listen(listenFd_, 6);
+    ret = listen(listenFd, 6);
     if (ret < 0) {
         LOG_ERROR("Listen port:%d error!", port_);
-        close(listenFd_);
+        close(listenFd);
         return false;
     }
     // 将listen_fd加入到epoll进行监听
-    ret = epoller_->AddFd(listenFd_, listenEvent_ | EPOLLIN);
+    ret = reactor->epoller->AddFd(listenFd, listenEvent_ | EPOLLIN);
     if (ret == 0) {
         LOG_ERROR("Add listen error!");
-        close(listenFd_);
+        close(listenFd);
         return false;
     }
     // 设置事件非堵塞
-    SetFdNonblock(listenFd_);
+    SetFdNonblock(listenFd);
+    reactor->listenFd = listenFd;
     LOG_INFO("Server port:%d", port_);
     return true;
 }
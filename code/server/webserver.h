@@ -6,22 +6,32 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
-#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <thread>
 #include <fcntl.h>       // fcntl()
 #include <unistd.h>      // close()
 #include <assert.h>
 #include <errno.h>
+#include <signal.h>
+#include <sys/signalfd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
 #include "epoller.h"
+#include "uringpoller.h"
+#include "conntable.h"
 #include "../log/log.h"
 #include "../timer/heaptimer.h"
+#include "../timer/timewheel.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/threadpool.h"
+#include "../pool/stealingpool.h"
 #include "../pool/sqlconnRAII.h"
 #include "../http/httpconn.h"
+#include "../http/precompress.h"
+#include "../config/config.h"
 
 class WebServer {
 public:
@@ -29,27 +39,61 @@ public:
         int port, int trigMode, int timeoutMS, bool OptLinger, 
         int sqlPort, const char* sqlUser, const  char* sqlPwd, 
         const char* dbName, int connPoolNum, int threadNum,
-        bool openLog, int logLevel, int logQueSize);
+        bool openLog, int logLevel, int logQueSize,
+        const Config &config = Config());
 
     ~WebServer();
     void Start();
 
 private:
-    bool InitSocket_(); 
+    // 一个Reactor对应一个epoll循环，独占自己的监听socket、定时器和所接受的连接
+    struct Reactor {
+        int listenFd = -1;
+        std::unique_ptr<Timer> timer;
+        std::unique_ptr<Poller> epoller;
+        // 线程池队列满时推迟处理的事件，期间连接不注册EPOLLIN/EPOLLOUT，不再产生新任务
+        struct Deferred {
+            HttpConn *client;
+            uint32_t gen;
+            bool write;
+        };
+        std::deque<Deferred> deferred;
+    };
+
+    static std::unique_ptr<Poller> CreatePoller_(bool ioUring);
+
+    bool InitSocket_(Reactor *reactor);
     void InitEventMode_(int trigMode);
-    void AddClient_(int fd, sockaddr_in addr);
-  
-    void DealListen_();
-    void DealWrite_(HttpConn* client);
-    void DealRead_(HttpConn* client);
+    void AddClient_(Reactor *reactor, int fd, sockaddr_in addr);
+
+    void Loop_(Reactor *reactor);
+    void DealListen_(Reactor *reactor);
+    void DealWrite_(Reactor *reactor, HttpConn* client);
+    void DealRead_(Reactor *reactor, HttpConn* client);
+    void DealSignal_();
+    void ReportMetrics_();
 
     void SendError_(int fd, const char*info);
-    void ExtentTime_(HttpConn* client);
-    void CloseConn_(HttpConn* client);
+    void ExtentTime_(Reactor *reactor, HttpConn* client);
+    void CloseConn_(Reactor *reactor, HttpConn* client);
+    void OnTimeout_(Reactor *reactor, int fd, uint32_t gen);
+
+    void OnRead_(Reactor *reactor, HttpConn* client);
+    void OnWrite_(Reactor *reactor, HttpConn* client);
+    void OnProcess(Reactor *reactor, HttpConn* client);
+
+    // 把任务交给线程池，配置了工作窃取时交给StealingPool，队列满时返回false
+    template<class F>
+    bool TryAddTask_(F &&task) {
+        if (stealingPool_) {
+            return stealingPool_->TryAddTask(std::forward<F>(task));
+        }
+        return threadpool_->TryAddTask(std::forward<F>(task));
+    }
 
-    void OnRead_(HttpConn* client);
-    void OnWrite_(HttpConn* client);
-    void OnProcess(HttpConn* client);
+    bool Dispatch_(Reactor *reactor, HttpConn *client, bool write);
+    void Overload_(Reactor *reactor, HttpConn *client, bool write);
+    void RetryDeferred_(Reactor *reactor);
 
     static const int MAX_FD = 65536;
 
@@ -59,16 +103,20 @@ private:
     bool openLinger_;
     int timeoutMS_;  /* 毫秒MS */
     bool isClose_;
-    int listenFd_;
+    bool oneLoopPerThread_;  /* 每个Reactor在自己的线程里直接处理读写，不经过线程池 */
+    bool rejectOverload_;    /* 线程池队列满时回复503，否则推迟处理 */
     char* srcDir_;
+    int signalFd_;  /* 接收SIGHUP，由第一个Reactor监听 */
+    int metricsIntervalMS_;  /* 输出统计的间隔，0为不输出 */
+    int64_t nextMetricsMS_;  /* 下次输出统计的时间 */
     
     uint32_t listenEvent_;
     uint32_t connEvent_;
    
-    std::unique_ptr<HeapTimer> timer_;
     std::unique_ptr<ThreadPool> threadpool_;
-    std::unique_ptr<Epoller> epoller_;
-    std::unordered_map<int, HttpConn> users_;
+    std::unique_ptr<StealingPool> stealingPool_;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    ConnTable users_;  /* fd唯一，所有Reactor共用一张表 */
 };
 
 
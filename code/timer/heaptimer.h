@@ -15,11 +15,7 @@
 #include <assert.h>
 #include <chrono>
 #include "../log/log.h"
-
-typedef std::function<void()> TimeoutCallBack;
-typedef std::chrono::high_resolution_clock Clock;
-typedef std::chrono::milliseconds MS;
-typedef Clock::time_point TimeStamp;
+#include "timer.h"
 
 // 定时器结点
 struct TimerNode {
@@ -32,31 +28,31 @@ struct TimerNode {
     }
 };
 
-class HeapTimer {
+class HeapTimer : public Timer {
 public:
     HeapTimer() { heap_.reserve(64); }
 
     ~HeapTimer() { clear(); }
 
     // 重新调整结点id的有效时间
-    void adjust(int id, int newExpires);
+    void adjust(int id, int newExpires) override;
 
     // 增加一个新的结点
-    void add(int id, int timeOut, const TimeoutCallBack &cb);
+    void add(int id, int timeOut, const TimeoutCallBack &cb) override;
 
     // 删除节点，并触发回调函数
-    void doWork(int id);
+    void doWork(int id) override;
 
     // 清空定时器
-    void clear();
+    void clear() override;
 
     // 清除超时结点
-    void tick();
+    void tick() override;
 
     // 弹出一个结点
     void pop();
 
-    int GetNextTick();
+    int GetNextTick() override;
 
 private:
     void del_(size_t i);
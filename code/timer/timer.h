@@ -0,0 +1,41 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-17
+ * @copyleft Apache 2.0
+ */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <functional>
+#include <chrono>
+
+typedef std::function<void()> TimeoutCallBack;
+typedef std::chrono::high_resolution_clock Clock;
+typedef std::chrono::milliseconds MS;
+typedef Clock::time_point TimeStamp;
+
+// 定时器接口，由HeapTimer(小根堆)和TimeWheel(时间轮)实现
+class Timer {
+public:
+    virtual ~Timer() = default;
+
+    // 重新调整结点id的有效时间
+    virtual void adjust(int id, int newExpires) = 0;
+
+    // 增加一个新的结点
+    virtual void add(int id, int timeOut, const TimeoutCallBack &cb) = 0;
+
+    // 删除节点，并触发回调函数
+    virtual void doWork(int id) = 0;
+
+    // 清空定时器
+    virtual void clear() = 0;
+
+    // 清除超时结点
+    virtual void tick() = 0;
+
+    // 距离下一个结点超时的毫秒数，没有结点时返回-1
+    virtual int GetNextTick() = 0;
+};
+
+#endif //TIMER_H
@@ -0,0 +1,195 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-17
+ * @copyleft Apache 2.0
+ */
+#include "timewheel.h"
+
+TimeWheel::TimeWheel(int tickMs) : start_(Clock::now()), tickMs_(tickMs), curTick_(0), count_(0) {
+    assert(tickMs > 0);
+    nodes_.reserve(64);
+    for (int i = 0; i < SLOT_NUM; i++) {
+        slots_[i] = -1;
+    }
+}
+
+uint64_t TimeWheel::NowTick_() const {
+    return std::chrono::duration_cast<MS>(Clock::now() - start_).count() / tickMs_.count();
+}
+
+TimeWheel::Node &TimeWheel::Node_(int id) {
+    assert(id >= 0);
+    if (static_cast<size_t>(id) >= nodes_.size()) {
+        nodes_.resize(id + 1);
+    }
+    return nodes_[id];
+}
+
+// 按超时tick距当前tick的远近挂到对应层的槽上
+void TimeWheel::Link_(int id) {
+    Node &node = nodes_[id];
+    uint64_t expires = node.expires < curTick_ ? curTick_ : node.expires;
+    uint64_t delta = expires - curTick_;
+    int slot;
+    if (delta < ROOT_SIZE) {
+        slot = expires & (ROOT_SIZE - 1);
+    } else {
+        int level = 1;
+        while (level < LEVELS - 1 && delta >= (1ULL << (ROOT_BITS + level * LEVEL_BITS))) {
+            level++;
+        }
+        /* 最外层一圈覆盖2^(ROOT_BITS+(LEVELS-1)*LEVEL_BITS)个tick，
+         * 超出范围的挂在最外层最远的槽，级联时会再重新计算 */
+        const uint64_t range = 1ULL << (ROOT_BITS + (LEVELS - 1) * LEVEL_BITS);
+        if (delta >= range) {
+            expires = curTick_ + range - 1;
+        }
+        int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+        slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE + ((expires >> shift) & (LEVEL_SIZE - 1));
+    }
+    node.linked = node.expires;
+    node.slot = slot;
+    node.prev = -1;
+    node.next = slots_[slot];
+    if (node.next != -1) {
+        nodes_[node.next].prev = id;
+    }
+    slots_[slot] = id;
+    count_++;
+}
+
+void TimeWheel::Unlink_(int id) {
+    Node &node = nodes_[id];
+    assert(node.slot != -1);
+    if (node.prev != -1) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        slots_[node.slot] = node.next;
+    }
+    if (node.next != -1) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.prev = node.next = node.slot = -1;
+    count_--;
+}
+
+// 把一个槽上的链表整体摘下，返回链表头
+int TimeWheel::DetachSlot_(int slot) {
+    int head = slots_[slot];
+    slots_[slot] = -1;
+    for (int id = head; id != -1; id = nodes_[id].next) {
+        nodes_[id].slot = -1;
+        count_--;
+    }
+    return head;
+}
+
+// 把第level层当前槽上的结点重新分配到更低的层
+void TimeWheel::Cascade_(int level) {
+    int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+    int slot = ROOT_SIZE + (level - 1) * LEVEL_SIZE + ((curTick_ >> shift) & (LEVEL_SIZE - 1));
+    int id = DetachSlot_(slot);
+    while (id != -1) {
+        int next = nodes_[id].next;
+        Link_(id);
+        id = next;
+    }
+}
+
+// 处理第0层的一个槽：到期的触发回调，被adjust延后的重新挂入
+void TimeWheel::Expire_(int slot) {
+    std::vector<int> expired;
+    int id = DetachSlot_(slot);
+    while (id != -1) {
+        int next = nodes_[id].next;
+        nodes_[id].prev = nodes_[id].next = -1;
+        if (nodes_[id].expires > curTick_) {
+            Link_(id);
+        } else {
+            expired.push_back(id);
+        }
+        id = next;
+    }
+    for (int i: expired) {
+        /* 回调中可能重新add该结点，此时不再触发 */
+        if (nodes_[i].slot != -1) { continue; }
+        TimeoutCallBack cb = std::move(nodes_[i].cb);
+        cb();
+    }
+}
+
+void TimeWheel::add(int id, int timeout, const TimeoutCallBack &cb) {
+    Node &node = Node_(id);
+    if (node.slot != -1) {
+        Unlink_(id);
+    }
+    node.cb = cb;
+    node.expires = NowTick_() + (timeout + tickMs_.count() - 1) / tickMs_.count();
+    Link_(id);
+}
+
+void TimeWheel::adjust(int id, int timeout) {
+    /* 调整指定id的结点，超时只会延后时不移动结点 */
+    assert(static_cast<size_t>(id) < nodes_.size() && nodes_[id].slot != -1);
+    Node &node = nodes_[id];
+    node.expires = NowTick_() + (timeout + tickMs_.count() - 1) / tickMs_.count();
+    if (node.expires < node.linked) {
+        Unlink_(id);
+        Link_(id);
+    }
+}
+
+void TimeWheel::doWork(int id) {
+    /* 删除指定id结点，并触发回调函数 */
+    if (id < 0 || static_cast<size_t>(id) >= nodes_.size() || nodes_[id].slot == -1) {
+        return;
+    }
+    Unlink_(id);
+    TimeoutCallBack cb = std::move(nodes_[id].cb);
+    cb();
+}
+
+void TimeWheel::clear() {
+    nodes_.clear();
+    for (int i = 0; i < SLOT_NUM; i++) {
+        slots_[i] = -1;
+    }
+    count_ = 0;
+}
+
+void TimeWheel::tick() {
+    /* 清除超时结点 */
+    uint64_t now = NowTick_();
+    while (curTick_ <= now) {
+        if (count_ == 0) {
+            /* 没有结点时直接跳到当前时间 */
+            curTick_ = now + 1;
+            break;
+        }
+        int index = curTick_ & (ROOT_SIZE - 1);
+        /* 第0层转完一圈，依次从上层级联 */
+        for (int level = 1; index == 0 && level < LEVELS; level++) {
+            Cascade_(level);
+            index = (curTick_ >> (ROOT_BITS + (level - 1) * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+        }
+        Expire_(curTick_ & (ROOT_SIZE - 1));
+        curTick_++;
+    }
+}
+
+int TimeWheel::GetNextTick() {
+    tick();
+    if (count_ == 0) {
+        return -1;
+    }
+    /* 下一次需要醒来的tick：第0层最近的非空槽，或者下一次级联的时刻 */
+    uint64_t target = (curTick_ + ROOT_SIZE - 1) & ~static_cast<uint64_t>(ROOT_SIZE - 1);
+    for (uint64_t t = curTick_; t < target; t++) {
+        if (slots_[t & (ROOT_SIZE - 1)] != -1) {
+            target = t;
+            break;
+        }
+    }
+    long long res = std::chrono::duration_cast<MS>(start_ + tickMs_ * target - Clock::now()).count();
+    return res < 0 ? 0 : static_cast<int>(res);
+}
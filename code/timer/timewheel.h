@@ -0,0 +1,84 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-06-17
+ * @copyleft Apache 2.0
+ */
+#ifndef TIME_WHEEL_H
+#define TIME_WHEEL_H
+
+#include <vector>
+#include <stdint.h>
+#include <assert.h>
+#include "timer.h"
+
+/* 分层时间轮，接口与HeapTimer一致
+ * 第0层256个槽，每槽一个tick；第1~3层各64个槽，每层的一个槽覆盖下一层一整圈。
+ * 结点以id(即fd)为下标存放在数组中，通过双向链表挂在槽上，add/doWork都是O(1)。
+ * adjust只更新结点的超时时间而不移动结点，等结点所在的槽到期时再按新的时间重新挂入，
+ * 因此每次读写事件刷新超时只是一次赋值 */
+class TimeWheel : public Timer {
+public:
+    explicit TimeWheel(int tickMs = 1);
+
+    ~TimeWheel() { clear(); }
+
+    // 重新调整结点id的有效时间
+    void adjust(int id, int newExpires) override;
+
+    // 增加一个新的结点
+    void add(int id, int timeOut, const TimeoutCallBack &cb) override;
+
+    // 删除节点，并触发回调函数
+    void doWork(int id) override;
+
+    // 清空定时器
+    void clear() override;
+
+    // 清除超时结点
+    void tick() override;
+
+    int GetNextTick() override;
+
+protected:
+    // 当前时间对应的tick，测试中可以替换时间源
+    virtual uint64_t NowTick_() const;
+
+private:
+    static const int ROOT_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int ROOT_SIZE = 1 << ROOT_BITS;
+    static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const int LEVELS = 4;
+    static const int SLOT_NUM = ROOT_SIZE + (LEVELS - 1) * LEVEL_SIZE;
+
+    struct Node {
+        int prev = -1;
+        int next = -1;
+        int slot = -1;          // 所在的槽，-1表示不在时间轮中
+        uint64_t expires = 0;   // 超时的tick
+        uint64_t linked = 0;    // 挂入槽时使用的超时tick
+        TimeoutCallBack cb;
+    };
+
+    Node &Node_(int id);
+
+    void Link_(int id);
+
+    void Unlink_(int id);
+
+    int DetachSlot_(int slot);
+
+    void Cascade_(int level);
+
+    void Expire_(int slot);
+
+    TimeStamp start_;
+    MS tickMs_;
+    uint64_t curTick_;  // 下一个待处理的tick
+    size_t count_;      // 时间轮中的结点数
+
+    std::vector<Node> nodes_;
+    int slots_[SLOT_NUM];
+};
+
+#endif //TIME_WHEEL_H
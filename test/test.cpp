@@ -5,6 +5,16 @@
  */ 
 #include "../code/log/log.h"
 #include "../code/pool/threadpool.h"
+#include "../code/pool/stealingpool.h"
+#include "../code/timer/heaptimer.h"
+#include "../code/timer/timewheel.h"
+#include "../code/http/httprequest.h"
+#include "../code/http/httptables.h"
+#include "../code/http/httpresponse.h"
+#include "../code/http/filecache.h"
+#include "../code/server/uringpoller.h"
+#include <unordered_map>
+#include <sys/socket.h>
 #include <features.h>
 
 #if __GLIBC__ == 2 && __GLIBC_MINOR__ < 30
@@ -35,6 +45,401 @@ void TestLog() {
     }
 }
 
+template<class T>
+void BenchTimer(const char *name, int n) {
+    /* 添加n个结点，模拟n次读写事件刷新超时，再逐个删除 */
+    T timer;
+    int fired = 0;
+    TimeStamp t0 = Clock::now();
+    for(int i = 0; i < n; i++) {
+        timer.add(i, 60000, [&fired] { fired++; });
+    }
+    TimeStamp t1 = Clock::now();
+    for(int i = 0; i < n; i++) {
+        timer.adjust(static_cast<int>((i * 7919LL) % n), 60000);
+    }
+    TimeStamp t2 = Clock::now();
+    for(int i = 0; i < n; i++) {
+        timer.doWork(i);
+    }
+    TimeStamp t3 = Clock::now();
+    assert(fired == n);
+    printf("%-10s n=%-8d add:%6ldms adjust:%6ldms doWork:%6ldms\n", name, n,
+           (long)std::chrono::duration_cast<MS>(t1 - t0).count(),
+           (long)std::chrono::duration_cast<MS>(t2 - t1).count(),
+           (long)std::chrono::duration_cast<MS>(t3 - t2).count());
+}
+
+// 由测试控制当前tick的时间轮
+class ManualWheel : public TimeWheel {
+public:
+    uint64_t now = 0;
+
+protected:
+    uint64_t NowTick_() const override { return now; }
+};
+
+void TestTimer() {
+    /* 时间轮的超时回调 */
+    TimeWheel wheel;
+    int fired = 0;
+    wheel.add(1, 5, [&fired] { fired++; });
+    wheel.add(2, 300, [&fired] { fired++; });
+    wheel.add(3, 5, [&fired] { fired++; });
+    wheel.adjust(3, 300);
+    usleep(20 * 1000);
+    wheel.tick();
+    assert(fired == 1);
+    assert(wheel.GetNextTick() > 0);
+    usleep(300 * 1000);
+    wheel.tick();
+    assert(fired == 3 && wheel.GetNextTick() == -1);
+
+    /* 超出最外层一圈(2^26个tick)的结点，到期前不触发，到期时准时触发 */
+    for(uint64_t timeout: {(1ULL << 26) + 12345, (1ULL << 26) + (1ULL << 25), 100000000ULL}) {
+        ManualWheel manual;
+        bool far = false, near = false;
+        manual.add(1, static_cast<int>(timeout), [&far] { far = true; });
+        manual.add(2, 1000, [&near] { near = true; });
+        manual.now = 1000;
+        manual.tick();
+        assert(near && !far);
+        manual.now = timeout - 1;
+        manual.tick();
+        assert(!far);
+        manual.now = timeout;
+        manual.tick();
+        assert(far);
+    }
+
+    for(int n: {10000, 100000, 1000000}) {
+        BenchTimer<HeapTimer>("HeapTimer", n);
+        BenchTimer<TimeWheel>("TimeWheel", n);
+    }
+}
+
+void TestHttpRequest() {
+    const char req[] = "GET /css/bootstrap.min.css HTTP/1.1\r\n"
+                       "Host: 127.0.0.1:1316\r\n"
+                       "Connection: keep-alive\r\n"
+                       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+                       "Accept: text/css,*/*;q=0.1\r\n"
+                       "Accept-Encoding: gzip, deflate, br\r\n"
+                       "Accept-Language: zh-CN,zh;q=0.9\r\n\r\n";
+    Buffer buff;
+    HttpRequest request;
+    buff.Append(req, sizeof(req) - 1);
+    assert(request.parse(buff) == HttpRequest::GET_REQUEST);
+    assert(request.path() == "/css/bootstrap.min.css" && request.method() == "GET");
+    assert(request.IsKeepAlive() && request.GetHeader("accept-encoding") == "gzip, deflate, br");
+    assert(buff.ReadableBytes() == 0);
+
+    /* 请求被拆成多段到达 */
+    const char post[] = "POST /index.html HTTP/1.1\r\nContent-Length: 7\r\n\r\na=1&b=2";
+    Buffer partial(16);
+    for(size_t i = 0; i + 1 < sizeof(post) - 1; i++) {
+        partial.Append(post + i, 1);
+        assert(request.parse(partial) == HttpRequest::NO_REQUEST);
+    }
+    partial.Append(post + sizeof(post) - 2, 1);
+    assert(request.parse(partial) == HttpRequest::GET_REQUEST);
+    assert(request.method() == "POST" && request.GetHeader("Content-Length") == "7");
+    assert(partial.ReadableBytes() == 0);
+
+    /* 只看请求行决定是否交给数据库通道 */
+    const char login[] = "POST /login HTTP/1.1\r\nContent-Length: 7\r\n";
+    assert(HttpRequest::IsDbRequest(login, login + sizeof(login) - 1));
+    assert(HttpRequest::IsDbRequest(login, login + 21) == false);
+    assert(HttpRequest::IsDbRequest(post, post + sizeof(post) - 1) == false);
+    assert(HttpRequest::IsDbRequest(req, req + sizeof(req) - 1) == false);
+
+    buff.Append("GET /\r\n\r\n", 11);
+    assert(request.parse(buff) == HttpRequest::BAD_REQUEST);
+    buff.RetrieveAll();
+    request.Init();
+
+    const int n = 1000000;
+    TimeStamp t0 = Clock::now();
+    for(int i = 0; i < n; i++) {
+        buff.Append(req, sizeof(req) - 1);
+        request.Init();
+        request.parse(buff);
+        buff.RetrieveAll();
+    }
+    long ms = std::chrono::duration_cast<MS>(Clock::now() - t0).count();
+    printf("HttpRequest parse: %d requests in %ldms, %.0f req/s\n", n, ms, n * 1000.0 / (ms ? ms : 1));
+}
+
+void TestBufferReadFd() {
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    int err = 0;
+
+    /* 中等大小的读取溢出后追加到合适大小的块，不接管64KB的溢出区 */
+    std::string small(3 * 1024, 'a');
+    for(size_t i = 0; i < small.size(); i++) { small[i] = 'a' + i % 26; }
+    assert(write(fds[1], small.data(), small.size()) == static_cast<ssize_t>(small.size()));
+    Buffer buff(1024);
+    assert(buff.ReadFd(fds[0], &err) == static_cast<ssize_t>(small.size()));
+    assert(buff.ReadableBytes() == small.size() && buff.Capacity() == 4 * 1024);
+    assert(std::string(buff.Peek(), buff.ReadableBytes()) == small);
+
+    /* 大块读取直接接管溢出区，数据保持完整 */
+    std::string large(48 * 1024, 'b');
+    for(size_t i = 0; i < large.size(); i++) { large[i] = 'A' + i % 26; }
+    assert(write(fds[1], large.data(), large.size()) == static_cast<ssize_t>(large.size()));
+    Buffer big(1024);
+    big.Append("x", 1);
+    size_t total = 0;
+    while(total < large.size()) {
+        ssize_t len = big.ReadFd(fds[0], &err);
+        assert(len > 0);
+        total += len;
+    }
+    assert(big.ReadableBytes() == large.size() + 1 && big.Capacity() == BlockPool::MAX_BLOCK);
+    assert(std::string(big.Peek() + 1, large.size()) == large);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void TestChainBuffer() {
+    ChainBuffer buff(1024);
+    std::string data;
+    for(int i = 0; i < 3000; i++) { data += char('a' + i % 26); }
+    buff.Append(data);
+    assert(buff.ReadableBytes() == 3000 && buff.Capacity() == 3072);
+
+    /* 跨块的一段导出为多个iovec，拼起来与原数据一致 */
+    std::vector<struct iovec> iov;
+    assert(buff.Peek(1000, 100, iov) == 100 && iov.size() == 2);
+    std::string slice;
+    for(auto &v: iov) { slice.append(static_cast<char *>(v.iov_base), v.iov_len); }
+    assert(slice == data.substr(1000, 100));
+
+    /* 追加另一个块链不拷贝数据 */
+    ChainBuffer other(1024);
+    other.Append("tail", 4);
+    iov.clear();
+    other.Peek(0, 4, iov);
+    buff.Append(std::move(other));
+    assert(other.ReadableBytes() == 0 && other.Capacity() == 0);
+    std::vector<struct iovec> moved;
+    buff.Peek(3000, 4, moved);
+    assert(moved.size() == 1 && moved[0].iov_base == iov[0].iov_base);
+
+    /* 读完的块还给池子 */
+    buff.Retrieve(2048);
+    assert(buff.ReadableBytes() == 956 && buff.Capacity() == 2048);
+
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    int err = 0;
+    assert(buff.WriteFd(fds[0], &err) == 956 && buff.ReadableBytes() == 0);
+    ChainBuffer in(1024);
+    in.Append(data.data(), 1000);
+    assert(in.ReadFd(fds[1], &err) == 956);
+    assert(in.RetrieveAllToStr() == data.substr(0, 1000) + data.substr(2048, 952) + "tail");
+    in.Release();
+    assert(in.Capacity() == 0);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void TestHttpTables() {
+    assert(HttpTables::MimeOf("/index.html") == "text/html");
+    assert(HttpTables::MimeOf("/fonts/a.woff2") == "font/woff2");
+    assert(HttpTables::MimeOf("/video/xxx.mp4") == "video/mp4");
+    assert(HttpTables::MimeOf("/src/app.ts") == "application/octet-stream");
+    assert(HttpTables::MimeOf("/a.unknown") == "text/plain");
+    assert(HttpTables::MimeOf("/noext") == "text/plain");
+    for(const auto &mime: HttpTables::MIME_TYPES) {
+        assert(HttpTables::FindMime(mime.suffix) == &mime);
+    }
+    assert(HttpTables::StatusOf(200) == 0 && HttpTables::StatusOf(999) == -1);
+
+    /* 与原来的unordered_map + substr查找对比 */
+    const std::unordered_map<std::string, std::string> suffixType = {
+        {".html", "text/html"}, {".xml", "text/xml"}, {".xhtml", "application/xhtml+xml"},
+        {".txt", "text/plain"}, {".rtf", "application/rtf"}, {".pdf", "application/pdf"},
+        {".word", "application/nsword"}, {".png", "image/png"}, {".gif", "image/gif"},
+        {".jpg", "image/jpeg"}, {".jpeg", "image/jpeg"}, {".au", "audio/basic"},
+        {".mpeg", "video/mpeg"}, {".mpg", "video/mpeg"}, {".avi", "video/x-msvideo"},
+        {".gz", "application/x-gzip"}, {".tar", "application/x-tar"}, {".css", "text/css"},
+        {".js", "text/javascript"},
+    };
+    const std::string paths[] = {"/index.html", "/css/bootstrap.min.css", "/js/jquery.js",
+                                 "/images/profile-image.jpg", "/video/xxx.mp4", "/favicon.ico"};
+    const int n = 10000000;
+    size_t sum = 0;
+    TimeStamp t0 = Clock::now();
+    for(int i = 0; i < n; i++) {
+        const std::string &path = paths[i % 6];
+        std::string::size_type idx = path.find_last_of('.');
+        auto it = suffixType.find(path.substr(idx));
+        sum += it == suffixType.end() ? 10 : it->second.size();
+    }
+    long mapMs = std::chrono::duration_cast<MS>(Clock::now() - t0).count();
+    t0 = Clock::now();
+    for(int i = 0; i < n; i++) {
+        sum += HttpTables::MimeOf(paths[i % 6]).size();
+    }
+    long tableMs = std::chrono::duration_cast<MS>(Clock::now() - t0).count();
+    printf("MIME lookup: %d lookups, unordered_map %ldms, perfect hash %ldms (%zu)\n", n, mapMs, tableMs, sum);
+}
+
+void TestErrorContent() {
+    std::string path = "/missing";
+    HttpResponse response;
+    Deflater::minSize = 64;
+    Deflater::level = 6;
+    response.Init("/tmp", path, false, 404);
+    response.SetAcceptEncoding("gzip", true);
+    ChainBuffer chunked;
+    response.ErrorContent(chunked, "File NotFound!");
+    std::string out = chunked.RetrieveAllToStr();
+    assert(out.find("Transfer-Encoding: chunked\r\n\r\n") != std::string::npos);
+    assert(out.compare(out.size() - 5, 5, "0\r\n\r\n") == 0);
+
+    /* HTTP/1.0或关闭即时压缩时退回Content-length */
+    response.SetAcceptEncoding("gzip", false);
+    ChainBuffer plain;
+    response.ErrorContent(plain, "File NotFound!");
+    assert(plain.RetrieveAllToStr().find("Content-length: ") == 0);
+    Deflater::level = 0;
+    response.SetAcceptEncoding("gzip", true);
+    response.ErrorContent(plain, "File NotFound!");
+    assert(plain.RetrieveAllToStr().find("Content-length: ") == 0);
+}
+
+// 进程打开的描述符数
+static int OpenFds() {
+    int n = 0;
+    DIR *dp = opendir("/proc/self/fd");
+    while (dp && readdir(dp)) { n++; }
+    if (dp) { closedir(dp); }
+    return n;
+}
+
+/* 用sendfile发送的大文件在缓存中保持打开，缓存的描述符数不能超过上限 */
+void TestFileCacheFds() {
+    char dir[] = "/tmp/testcacheXXXXXX";
+    assert(mkdtemp(dir));
+    const int files = 64;
+    std::string content(4096, 'x');
+    for(int i = 0; i < files; i++) {
+        FILE *fp = fopen((std::string(dir) + "/" + std::to_string(i) + ".bin").c_str(), "w");
+        fwrite(content.data(), 1, content.size(), fp);
+        fclose(fp);
+    }
+    size_t threshold = HttpResponse::sendfileThreshold;
+    HttpResponse::sendfileThreshold = 1024;
+    FileCache::Instance()->Init(dir, 64 << 20, 16);
+    int before = OpenFds();
+    for(int round = 0; round < 2; round++) {
+        for(int i = 0; i < files; i++) {
+            auto entry = FileCache::Instance()->Get("/" + std::to_string(i) + ".bin");
+            assert(entry && entry->fd >= 0);
+        }
+    }
+    assert(OpenFds() - before <= 16);
+
+    /* 小于分片数时大文件不缓存，放下引用就关闭 */
+    FileCache::Instance()->Init(dir, 64 << 20, 0);
+    before = OpenFds();
+    for(int i = 0; i < files; i++) {
+        assert(FileCache::Instance()->Get("/" + std::to_string(i) + ".bin"));
+    }
+    assert(OpenFds() == before);
+    FileCache::Instance()->Clear();
+    HttpResponse::sendfileThreshold = threshold;
+    for(int i = 0; i < files; i++) {
+        unlink((std::string(dir) + "/" + std::to_string(i) + ".bin").c_str());
+    }
+    rmdir(dir);
+}
+
+/* 后台重新加载预加载区，加载完成前请求仍然使用旧的；
+ * 预加载模式下文件的gzip结果按所属的预加载区判断是否最新 */
+void TestPreloadAsync() {
+    char dir[] = "/tmp/testarenaXXXXXX";
+    assert(mkdtemp(dir));
+    std::string file = std::string(dir) + "/a.html";
+    FILE *fp = fopen(file.c_str(), "w");
+    fputs(std::string(4096, 'a').c_str(), fp);
+    fclose(fp);
+    FileCache *cache = FileCache::Instance();
+    cache->Init(dir, 64 << 20, 16);
+    assert(cache->Preload());
+    auto old = cache->Get("/a.html");
+    assert(old && old->st.st_size == 4096);
+    auto gzip = cache->GetGzip("/a.html", old);
+    assert(gzip && cache->GetGzip("/a.html", old) == gzip);
+
+    fp = fopen(file.c_str(), "w");
+    fputs(std::string(8192, 'b').c_str(), fp);
+    fclose(fp);
+    std::atomic<int> done(0);
+    for(int i = 0; i < 3; i++) {
+        cache->PreloadAsync([&done] { done++; });
+    }
+    while(done == 0 || cache->Get("/a.html")->st.st_size != 8192) {
+        std::this_thread::yield();
+    }
+    /* 旧预加载区的文件压缩结果不放入缓存 */
+    auto stale = cache->GetGzip("/a.html", old);
+    assert(stale && cache->GetGzip("/a.html", old) != stale);
+    auto fresh = cache->Get("/a.html");
+    auto gzip2 = cache->GetGzip("/a.html", fresh);
+    assert(gzip2 && cache->GetGzip("/a.html", fresh) == gzip2);
+    cache->Init(dir, 0, 0);
+    unlink(file.c_str());
+    rmdir(dir);
+}
+
+/* 事件循环把就绪的fd交给线程池，工作线程重新注册EPOLLONESHOT，统计系统调用次数
+ * 原来每次重新注册都要一次io_uring_enter，现在合并到事件循环的Wait中提交 */
+void TestUringPoller() {
+    UringPoller poller;
+    if (!poller.IsValid()) {
+        printf("io_uring re-arm: io_uring not supported, skipped\n");
+        return;
+    }
+    const int conns = 64, total = 200000;
+    int fds[conns][2];
+    for(int i = 0; i < conns; i++) {
+        assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]) == 0);
+        assert(write(fds[i][1], "x", 1) == 1);  // 始终可读，每次注册都会立即触发
+        poller.AddFd(fds[i][0], EPOLLIN | EPOLLONESHOT);
+    }
+    std::atomic<int> rearms(0);
+    int dispatched = 0, waits = 0;
+    {
+        ThreadPool pool(4);
+        while(dispatched < total) {
+            int n = poller.Wait(100);
+            waits++;
+            for(int i = 0; i < n && dispatched < total; i++, dispatched++) {
+                int fd = poller.GetEventFd(i);
+                assert(poller.GetEvents(i) & EPOLLIN);
+                pool.AddTask([&poller, &rearms, fd] {
+                    poller.ModFd(fd, EPOLLIN | EPOLLONESHOT);
+                    rearms++;
+                });
+            }
+        }
+    }
+    assert(rearms == total);
+    size_t syscalls = poller.Enters() + poller.Wakes();
+    printf("io_uring re-arm: %d re-arms from workers, %d waits, %zu io_uring_enter + %zu wakeups"
+           " (one enter per re-arm: %d)\n", total, waits, poller.Enters(), poller.Wakes(), total + waits);
+    assert(syscalls < static_cast<size_t>(total + waits));
+    for(int i = 0; i < conns; i++) {
+        poller.DelFd(fds[i][0]);
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+}
+
 void ThreadLogTask(int i, int cnt) {
     for(int j = 0; j < 10000; j++ ){
         LOG_BASE(i,"PID:[%04d]======= %05d ========= ", gettid(), cnt++);
@@ -50,7 +455,184 @@ void TestThreadPool() {
     getchar();
 }
 
+/* 模拟事件循环：一个线程提交大量小任务，等全部执行完 */
+template<class Pool>
+long PoolBench(size_t threadNum, int taskNum) {
+    std::atomic<int> done(0);
+    Pool pool(threadNum);
+    TimeStamp t0 = Clock::now();
+    for(int i = 0; i < taskNum; i++) {
+        pool.AddTask([&done] {
+            volatile int x = 0;
+            for(int k = 0; k < 200; k++) { x += k; }
+            done++;
+        });
+    }
+    while(done < taskNum) { std::this_thread::yield(); }
+    return std::chrono::duration_cast<MS>(Clock::now() - t0).count();
+}
+
+void TestTask() {
+    /* 只能移动的可调用对象也可以作为任务 */
+    std::unique_ptr<int> value(new int(1));
+    Task task([value = std::move(value)] { (*value)++; });
+    Task moved(std::move(task));
+    assert(!task && moved);
+    moved();
+
+    int *p = nullptr;
+    auto small = [p, q = p, r = p] { (void) p; (void) q; (void) r; };
+    static_assert(Task::IsInline<decltype(small)>::value, "three pointers fit inline");
+    static_assert(Task::IsInline<decltype(std::bind(&Log::flush, Log::Instance()))>::value, "bind fits inline");
+
+    /* 超出内联空间的在堆上分配，同样能移动和执行 */
+    char big[128] = {1};
+    int sum = 0;
+    Task large([big, &sum] { sum += big[0]; });
+    Task other;
+    other = std::move(large);
+    other();
+    assert(sum == 1);
+}
+
+void TestTryAddTask() {
+    /* 唯一的工作线程被阻塞，队列满后TryAddTask返回false */
+    std::atomic<bool> started(false), release(false);
+    std::atomic<int> done(0);
+    ThreadPool pool(1, 4);
+    pool.AddTask([&] {
+        started = true;
+        while(!release) { std::this_thread::yield(); }
+    });
+    while(!started) { std::this_thread::yield(); }
+    int accepted = 0;
+    while(pool.TryAddTask([&done] { done++; })) { accepted++; }
+    assert(accepted == 4 && pool.QueueSize() == 4);
+    release = true;
+    while(done < accepted) { std::this_thread::yield(); }
+    assert(pool.TryAddTask([&done] { done++; }));
+}
+
+void TestThreadPoolLanes() {
+    /* 慢速通道被阻塞时，快速通道的任务照常执行 */
+    std::atomic<bool> release(false);
+    std::atomic<int> done(0);
+    {
+        ThreadPool pool(1, 16, 1);
+        assert(pool.HasSlowLane());
+        pool.AddTask([&] {
+            while(!release) { std::this_thread::yield(); }
+            done++;
+        }, ThreadPool::SLOW);
+        for(int i = 0; i < 10; i++) {
+            pool.AddTask([&done] { done++; });
+        }
+        while(done < 10) { std::this_thread::yield(); }
+        release = true;
+        while(done < 11) { std::this_thread::yield(); }
+    }
+    ThreadPool single(2);
+    assert(!single.HasSlowLane());
+    single.AddTask([&done] { done++; }, ThreadPool::SLOW);
+    while(done < 12) { std::this_thread::yield(); }
+}
+
+void TestElasticPool() {
+    /* 任务排队太久时增加线程，空闲后退回初始线程数；析构时执行完剩余任务并回收线程 */
+    ThreadPool::Elastic elastic;
+    elastic.maxThreads = 4;
+    elastic.growWaitUs = 1000;
+    elastic.idleMs = 100;
+    std::atomic<int> done(0);
+    size_t peak = 0;
+    {
+        ThreadPool pool(1, 64, 0, elastic);
+        for(int i = 0; i < 40; i++) {
+            pool.AddTask([&done] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                done++;
+            });
+        }
+        while(done < 40) {
+            peak = std::max(peak, pool.GetMetrics().threads);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        ThreadPool::Metrics metrics = pool.GetMetrics();
+        uint64_t waited = 0;
+        for(uint64_t count: metrics.waitHist) { waited += count; }
+        assert(peak > 1 && peak <= 4);
+        assert(metrics.threads == 1 && metrics.busyRatio.size() == 1);
+        assert(metrics.tasks == 40 && waited == 40 && metrics.WaitPercentileUs(0.99) >= 1000);
+        printf("ElasticPool: peak %zu threads, wait p50 <%lluus p99 <%lluus\n", peak,
+               (unsigned long long) metrics.WaitPercentileUs(0.5), (unsigned long long) metrics.WaitPercentileUs(0.99));
+        for(int i = 0; i < 10; i++) {
+            pool.AddTask([&done] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                done++;
+            });
+        }
+    }
+    assert(done == 50);
+
+    /* 唯一的线程阻塞在任务中(如等数据库)时，提交任务就要增加线程，不等它取出任务 */
+    {
+        ThreadPool pool(1, 64, 0, elastic);
+        std::atomic<bool> release(false);
+        std::atomic<int> quick(0);
+        pool.AddTask([&release] {
+            while(!release) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        pool.AddTask([&quick] { quick++; });
+        for(int i = 0; i < 500 && quick == 0; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        assert(quick == 1 && !release && pool.GetMetrics().threads == 2);
+        release = true;
+    }
+}
+
+void TestStealingPool() {
+    /* 工作线程中提交的子任务进入自己的队列，被其他线程窃取 */
+    std::atomic<int> done(0);
+    {
+        StealingPool pool(4);
+        for(int i = 0; i < 100; i++) {
+            pool.AddTask([&pool, &done] {
+                for(int j = 0; j < 100; j++) {
+                    pool.AddTask([&done] { done++; });
+                }
+                done++;
+            });
+        }
+    }
+    assert(done == 100 * 101);
+
+    const int n = 200000;
+    for(size_t threadNum: {1, 2, 4, 8, 16, 32, 64}) {
+        long lockMs = PoolBench<ThreadPool>(threadNum, n);
+        long stealMs = PoolBench<StealingPool>(threadNum, n);
+        printf("ThreadPool vs StealingPool: %2zu threads, %d tasks, %5ldms vs %5ldms\n",
+               threadNum, n, lockMs, stealMs);
+    }
+}
+
 int main() {
     TestLog();
+    TestTimer();
+    TestHttpRequest();
+    TestBufferReadFd();
+    TestChainBuffer();
+    TestHttpTables();
+    TestErrorContent();
+    TestFileCacheFds();
+    TestPreloadAsync();
+    TestUringPoller();
+    TestTask();
+    TestTryAddTask();
+    TestThreadPoolLanes();
+    TestElasticPool();
+    TestStealingPool();
     TestThreadPool();
 }
\ No newline at end of file